@@ -0,0 +1,235 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <rex/binary.hpp>
+#include <rex/exceptions.hpp>
+#include <rex/filelister.hpp>
+#include <rex/filesource.hpp>
+#include <rex/filter.hpp>
+#include <rex/mappedfile.hpp>
+
+namespace rex
+{
+    //archives bundle many assets in one file so that they are found without touching the file system. the layout is, with all numbers little endian:
+    //header: "REXA", uint32 version, uint32 entry count
+    //index: per entry a uint32 id length, the id, uint64 offset from the start of the file, uint64 size and uint32 checksum
+    //data: the assets back to back
+    struct ArchiveEntry
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t checksum;
+    };
+
+    class Archive
+    {
+        public:
+            static constexpr uint32_t Version = 1;
+            Archive(const Path& path);
+            std::vector<std::string> list() const;
+            const ArchiveEntry& entry(const std::string& id) const;
+            const char* data(const ArchiveEntry& entry) const;
+            static uint32_t checksum(const char* data, size_t size);
+        private:
+            MappedFile mFile;
+            std::unordered_map<std::string, ArchiveEntry> mEntries;
+    };
+
+    class ArchiveWriter
+    {
+        public:
+            void add(const std::string& id, std::string data);
+            void addFile(const std::string& id, const Path& path);
+            //adds files the same way as a FileSource set up with the same arguments would find them
+            void addFolder(const Path& folder, const Filter& filter = Filter(), Naming naming = Naming::NO_EXT);
+            void write(const Path& path) const;
+        private:
+            struct Asset
+            {
+                std::string id;
+                //files are only read when writing, so that packing doesn't keep every asset in memory
+                std::string path;
+                std::string data;
+                bool isFile;
+            };
+
+            void reserve(const std::string& id);
+
+            std::vector<Asset> mAssets;
+            std::unordered_set<std::string> mIds;
+    };
+
+    namespace archive
+    {
+        const char Magic[4] = {'R', 'E', 'X', 'A'};
+    }
+
+    inline Archive::Archive(const Path& path):
+        mFile(path)
+    {
+        const char* position = mFile.data();
+        const char* end = position + mFile.size();
+        std::string invalid = "'" + path.str() + "' is not a valid archive";
+
+        if(mFile.size() < 12 || std::memcmp(position, archive::Magic, 4) != 0)
+            throw InvalidFileException(invalid);
+
+        position += 4;
+
+        if(binary::readNumber(position, 4) != Version)
+            throw InvalidFileException("'" + path.str() + "' is an archive of an unsupported version");
+
+        uint64_t count = binary::readNumber(position, 4);
+        mEntries.reserve(count);
+
+        for(uint64_t i = 0; i < count; ++i)
+        {
+            if(end - position < 4)
+                throw InvalidFileException(invalid);
+
+            uint64_t idLength = binary::readNumber(position, 4);
+
+            if(static_cast<uint64_t>(end - position) < idLength + 20)
+                throw InvalidFileException(invalid);
+
+            std::string id(position, idLength);
+            position += idLength;
+
+            ArchiveEntry entry;
+            entry.offset = binary::readNumber(position, 8);
+            entry.size = binary::readNumber(position, 8);
+            entry.checksum = static_cast<uint32_t>(binary::readNumber(position, 4));
+
+            if(entry.offset > mFile.size() || entry.size > mFile.size() - entry.offset)
+                throw InvalidFileException(invalid);
+
+            mEntries.emplace(std::move(id), entry);
+        }
+    }
+
+    inline std::vector<std::string> Archive::list() const
+    {
+        std::vector<std::string> result;
+
+        for(const auto& entry : mEntries)
+            result.push_back(entry.first);
+
+        return result;
+    }
+
+    inline const ArchiveEntry& Archive::entry(const std::string& id) const
+    {
+        auto entryIter = mEntries.find(id);
+
+        if(entryIter == mEntries.end())
+            throw InvalidResourceException("archive has no entry '" + id + "'");
+
+        return entryIter->second;
+    }
+
+    inline const char* Archive::data(const ArchiveEntry& entry) const
+    {
+        return mFile.data() + entry.offset;
+    }
+
+    inline uint32_t Archive::checksum(const char* data, size_t size)
+    {
+        //FNV-1a, which is plenty to catch truncated or damaged archives
+        uint32_t hash = 2166136261u;
+
+        for(size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    inline void ArchiveWriter::add(const std::string& id, std::string data)
+    {
+        reserve(id);
+        mAssets.push_back(Asset{id, std::string(), std::move(data), false});
+    }
+
+    inline void ArchiveWriter::addFile(const std::string& id, const Path& path)
+    {
+        reserve(id);
+        mAssets.push_back(Asset{id, path.str(), std::string(), true});
+    }
+
+    inline void ArchiveWriter::addFolder(const Path& folder, const Filter& filter, Naming naming)
+    {
+        FileLister lister(folder, FileLister::FILES);
+
+        lister.forEach([&] (const std::string& path)
+        {
+            if(filter.matches(path))
+                addFile(resourceName(path, naming), path);
+        });
+    }
+
+    inline void ArchiveWriter::write(const Path& path) const
+    {
+        std::ofstream out(path.str(), std::ios::binary | std::ios::trunc);
+
+        if(!out)
+            throw InvalidFileException("cannot open '" + path.str() + "' for writing");
+
+        uint64_t indexEnd = 12;
+
+        for(const auto& asset : mAssets)
+            indexEnd += 4 + asset.id.size() + 20;
+
+        //the assets are written first and the index filled in afterwards, once their sizes and checksums are known
+        std::vector<ArchiveEntry> entries;
+        entries.reserve(mAssets.size());
+        out.seekp(static_cast<std::streamoff>(indexEnd));
+
+        auto writeAsset = [&out, &entries] (const char* data, size_t size)
+        {
+            entries.push_back(ArchiveEntry{static_cast<uint64_t>(out.tellp()), size, Archive::checksum(data, size)});
+            out.write(data, static_cast<std::streamsize>(size));
+        };
+
+        for(const auto& asset : mAssets)
+        {
+            if(asset.isFile)
+            {
+                MappedFile file(asset.path);
+                writeAsset(file.data(), file.size());
+            }
+            else
+                writeAsset(asset.data.data(), asset.data.size());
+        }
+
+        out.seekp(0);
+        out.write(archive::Magic, 4);
+        binary::writeNumber(out, Archive::Version, 4);
+        binary::writeNumber(out, mAssets.size(), 4);
+
+        for(size_t i = 0; i < mAssets.size(); ++i)
+        {
+            binary::writeString(out, mAssets[i].id);
+            binary::writeNumber(out, entries[i].offset, 8);
+            binary::writeNumber(out, entries[i].size, 8);
+            binary::writeNumber(out, entries[i].checksum, 4);
+        }
+
+        if(!out)
+            throw InvalidFileException("failed writing archive '" + path.str() + "'");
+    }
+
+    inline void ArchiveWriter::reserve(const std::string& id)
+    {
+        if(!mIds.insert(id).second)
+            throw AmbiguousNameException("archive already has an entry named '" + id + "'");
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <rex/archive.hpp>
+#include <rex/exceptions.hpp>
+
+namespace rex
+{
+    //serves the assets of an archive made with ArchiveWriter. listing only reads the index, and loading hands the loader a slice of the mapped archive
+    template <typename ResourceType>
+    class ArchiveSource
+    {
+        public:
+            ArchiveSource(const Path& archivePath, bool verifyChecksums = true);
+            ResourceType load(const std::string& id) const;
+            std::vector<std::string> list() const;
+        protected:
+            //the memory stays valid for as long as any copy of the source exists
+            virtual ResourceType loadFromMemory(const char* data, size_t size) const = 0;
+            std::shared_ptr<const Archive> mArchive;
+            bool mVerifyChecksums;
+    };
+
+    template <typename ResourceType>
+    ArchiveSource<ResourceType>::ArchiveSource(const Path& archivePath, bool verifyChecksums):
+        mArchive(std::make_shared<const Archive>(archivePath)),
+        mVerifyChecksums(verifyChecksums)
+    {
+    }
+
+    template <typename ResourceType>
+    ResourceType ArchiveSource<ResourceType>::load(const std::string& id) const
+    {
+        try
+        {
+            const ArchiveEntry& entry = mArchive->entry(id);
+            const char* data = mArchive->data(entry);
+            size_t size = static_cast<size_t>(entry.size);
+
+            if(mVerifyChecksums && Archive::checksum(data, size) != entry.checksum)
+                throw InvalidFileException("the archived data is damaged");
+
+            return loadFromMemory(data, size);
+        }
+        catch(const std::exception& e)
+        {
+            throw rex::InvalidResourceException("With resource '" + id + "', " + e.what());
+        }
+    }
+
+    template <typename ResourceType>
+    std::vector<std::string> ArchiveSource<ResourceType>::list() const
+    {
+        return mArchive->list();
+    }
+}
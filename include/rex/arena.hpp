@@ -0,0 +1,95 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rex
+{
+    //hands out slots for objects from chunks that are never moved, so addresses stay stable for as long as the object lives. it is not thread safe
+    template <typename Type>
+    class Arena
+    {
+        public:
+            Arena(size_t chunkSize);
+            Type* create(Type&& object);
+            void destroy(Type* object);
+            //gives back all the memory at once. the objects must already be destroyed, unless they are trivially destructible
+            void clear();
+            size_t chunkSize() const;
+        private:
+            using Slot = typename std::aligned_storage<sizeof(Type), alignof(Type)>::type;
+            Slot* allocate();
+
+            size_t mChunkSize;
+            std::vector<std::unique_ptr<Slot[]>> mChunks;
+            //slots handed out from the last chunk
+            size_t mUsed;
+            std::vector<Slot*> mFreeSlots;
+    };
+
+    template <typename Type>
+    Arena<Type>::Arena(size_t chunkSize):
+        mChunkSize(chunkSize != 0 ? chunkSize : 1),
+        mUsed(0)
+    {
+    }
+
+    template <typename Type>
+    Type* Arena<Type>::create(Type&& object)
+    {
+        Slot* slot = allocate();
+
+        try
+        {
+            return new(slot) Type(std::move(object));
+        }
+        catch(...)
+        {
+            mFreeSlots.push_back(slot);
+            throw;
+        }
+    }
+
+    template <typename Type>
+    void Arena<Type>::destroy(Type* object)
+    {
+        object->~Type();
+        mFreeSlots.push_back(reinterpret_cast<Slot*>(object));
+    }
+
+    template <typename Type>
+    void Arena<Type>::clear()
+    {
+        mChunks.clear();
+        mFreeSlots.clear();
+        mUsed = 0;
+    }
+
+    template <typename Type>
+    size_t Arena<Type>::chunkSize() const
+    {
+        return mChunkSize;
+    }
+
+    template <typename Type>
+    typename Arena<Type>::Slot* Arena<Type>::allocate()
+    {
+        if(!mFreeSlots.empty())
+        {
+            Slot* slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            return slot;
+        }
+
+        if(mChunks.empty() || mUsed == mChunkSize)
+        {
+            mChunks.emplace_back(new Slot[mChunkSize]);
+            mUsed = 0;
+        }
+
+        return &mChunks.back()[mUsed++];
+    }
+}
@@ -2,13 +2,16 @@
 #include <rex/config.hpp>
 #include <string>
 #include <future>
+#include <rex/resourcehandle.hpp>
 
 namespace rex
 {
+    //the view keeps the resource alive, so it stays valid even if the resource is marked as unused meanwhile
     template <typename ResourceType>
     struct AsyncResourceView
     {
         std::string identifier;
         std::shared_future<const ResourceType&> future;
+        ResourceHandle<ResourceType> handle;
     };
 }
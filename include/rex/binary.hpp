@@ -0,0 +1,88 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace rex
+{
+    //helpers for the little endian formats of archives and manifests
+    namespace binary
+    {
+        inline void writeNumber(std::ostream& out, uint64_t number, size_t bytes)
+        {
+            for(size_t i = 0; i < bytes; ++i)
+                out.put(static_cast<char>((number >> (i * 8)) & 0xff));
+        }
+
+        inline void writeString(std::ostream& out, const std::string& text)
+        {
+            writeNumber(out, text.size(), 4);
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+
+        inline uint64_t readNumber(const char*& position, size_t bytes)
+        {
+            uint64_t number = 0;
+
+            for(size_t i = 0; i < bytes; ++i)
+                number |= static_cast<uint64_t>(static_cast<unsigned char>(position[i])) << (i * 8);
+
+            position += bytes;
+            return number;
+        }
+
+        //bounds checked reading, where a failed read leaves the reader failed for good
+        class Reader
+        {
+            public:
+                Reader(const char* data, size_t size);
+                uint64_t number(size_t bytes);
+                std::string string();
+                bool failed() const;
+            private:
+                const char* mPosition;
+                const char* mEnd;
+                bool mFailed;
+        };
+
+        inline Reader::Reader(const char* data, size_t size):
+            mPosition(data),
+            mEnd(data + size),
+            mFailed(data == nullptr)
+        {
+        }
+
+        inline uint64_t Reader::number(size_t bytes)
+        {
+            if(mFailed || static_cast<size_t>(mEnd - mPosition) < bytes)
+            {
+                mFailed = true;
+                return 0;
+            }
+
+            return readNumber(mPosition, bytes);
+        }
+
+        inline std::string Reader::string()
+        {
+            uint64_t length = number(4);
+
+            if(mFailed || static_cast<uint64_t>(mEnd - mPosition) < length)
+            {
+                mFailed = true;
+                return std::string();
+            }
+
+            std::string text(mPosition, length);
+            mPosition += length;
+            return text;
+        }
+
+        inline bool Reader::failed() const
+        {
+            return mFailed;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <rex/config.hpp>
+#include <atomic>
+#include <cstddef>
+
+namespace rex
+{
+    //any number of threads push indices, and a single consumer takes all of them at once. neither side ever blocks
+    class CompletionQueue
+    {
+        public:
+            CompletionQueue();
+            CompletionQueue(const CompletionQueue& other) = delete;
+            CompletionQueue& operator=(const CompletionQueue& other) = delete;
+            ~CompletionQueue();
+            void push(size_t index);
+            //calls the function with every index pushed since the last drain, in the order they were pushed
+            template <typename Function>
+            void drain(Function&& function);
+        private:
+            struct Node
+            {
+                size_t index;
+                Node* next;
+            };
+
+            static void destroy(Node* node);
+
+            std::atomic<Node*> mHead;
+    };
+
+    inline CompletionQueue::CompletionQueue():
+        mHead(nullptr)
+    {
+    }
+
+    inline CompletionQueue::~CompletionQueue()
+    {
+        destroy(mHead.load());
+    }
+
+    inline void CompletionQueue::push(size_t index)
+    {
+        Node* node = new Node{index, mHead.load(std::memory_order_relaxed)};
+
+        while(!mHead.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    template <typename Function>
+    void CompletionQueue::drain(Function&& function)
+    {
+        //the consumer takes the whole list, so nodes are never popped one by one and ABA can't happen
+        Node* taken = mHead.exchange(nullptr, std::memory_order_acquire);
+
+        if(!taken)
+            return;
+
+        Node* ordered = nullptr;
+
+        while(taken)
+        {
+            Node* next = taken->next;
+            taken->next = ordered;
+            ordered = taken;
+            taken = next;
+        }
+
+        //whatever is left is freed if the function throws
+        struct Remaining
+        {
+            ~Remaining()
+            {
+                destroy(nodes);
+            }
+
+            Node* nodes;
+        } remaining{ordered};
+
+        while(remaining.nodes)
+        {
+            Node* node = remaining.nodes;
+            remaining.nodes = node->next;
+
+            size_t index = node->index;
+            delete node;
+            function(index);
+        }
+    }
+
+    inline void CompletionQueue::destroy(Node* node)
+    {
+        while(node)
+        {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+}
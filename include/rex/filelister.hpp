@@ -6,6 +6,23 @@
 #include <rex/path.hpp>
 #include <rex/tinydir.hpp>
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef REX_DISABLE_ASYNC
+#include <atomic>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <rex/threadpool.hpp>
+#endif
+
 namespace rex
 {
     class FileLister
@@ -15,8 +32,36 @@ namespace rex
 
             FileLister(Path folderPath, Mode listingMode);
             std::vector<Path> list() const;
+#ifndef REX_DISABLE_ASYNC
+            //scans every folder as its own task on the pool. the order of the result is unspecified
+            std::vector<Path> list(ThreadPool& pool) const;
+#endif
+            //calls the function with the path of every entry as it is found, without collecting them first
+            template <typename Function>
+            void forEach(Function&& function) const;
+            //like forEach, but gives every entry regardless of the mode, together with whether it is a folder. folders are given before their contents
+            template <typename Function>
+            void forEachEntry(Function&& function) const;
         private:
-            void fetchFilesRecursively(const Path& folder, std::vector<Path>& output) const;
+            static bool wanted(Mode mode, bool isDirectory);
+            static bool isDots(const char* name);
+            //lists a single folder, giving the full path of each entry together with whether it is a folder
+            template <typename Function>
+            static void scanFolder(const std::string& folderPath, Function&& function);
+#ifndef REX_DISABLE_ASYNC
+            struct ParallelScan
+            {
+                ThreadPool* pool;
+                Mode mode;
+                std::mutex mutex;
+                std::vector<Path> result;
+                std::exception_ptr error;
+                std::atomic<size_t> outstanding;
+                std::promise<void> done;
+            };
+
+            static void scanParallel(std::shared_ptr<ParallelScan> scan, std::string folderPath);
+#endif
             Path mFolderPath;
             Mode mMode;
     };
@@ -25,6 +70,7 @@ namespace rex
         mFolderPath(std::move(folderPath)),
         mMode(listingMode)
     {
+#ifdef _WIN32
         tinydir_dir folder;
         int32_t result = tinydir_open(&folder, mFolderPath.str().c_str());
 
@@ -32,69 +78,256 @@ namespace rex
             throw InvalidFileException("given path '" + mFolderPath.str() + "' is not a valid directory");
         else
             tinydir_close(&folder);
+#else
+        struct stat status;
+
+        if(stat(mFolderPath.str().c_str(), &status) != 0 || !S_ISDIR(status.st_mode))
+            throw InvalidFileException("given path '" + mFolderPath.str() + "' is not a valid directory");
+#endif
     }
 
     inline std::vector<Path> FileLister::list() const
     {
         std::vector<Path> result;
-        fetchFilesRecursively(mFolderPath, result);
+
+        forEach([&result] (const std::string& path)
+        {
+            result.emplace_back(path);
+        });
 
         return result;
     }
 
-    inline void FileLister::fetchFilesRecursively(const Path& folderPath, std::vector<Path>& output) const
+#ifndef REX_DISABLE_ASYNC
+    inline std::vector<Path> FileLister::list(ThreadPool& pool) const
     {
-        tinydir_dir folder;
-        int32_t result = tinydir_open(&folder, folderPath.str().c_str());
+        if(pool.threadCount() == 0)
+            return list();
 
-        if(result != 0)
-            throw InvalidFileException("given path '" + folderPath.str() + "' is not a valid directory");
+        auto scan = std::make_shared<ParallelScan>();
+        scan->pool = &pool;
+        scan->mode = mMode;
+        scan->outstanding = 1;
+        std::future<void> done = scan->done.get_future();
 
-        while(folder.has_next)
+        scanParallel(scan, mFolderPath.str());
+        pool.wait(done);
+
+        if(scan->error)
+            std::rethrow_exception(scan->error);
+
+        return std::move(scan->result);
+    }
+#endif
+
+    template <typename Function>
+    void FileLister::forEach(Function&& function) const
+    {
+        Mode mode = mMode;
+
+        forEachEntry([&function, mode] (const std::string& path, bool isDirectory)
         {
-            tinydir_file file;
-            tinydir_readfile(&folder, &file);
-            tinydir_next(&folder);
+            if(wanted(mode, isDirectory))
+                function(path);
+        });
+    }
+
+    template <typename Function>
+    void FileLister::forEachEntry(Function&& function) const
+    {
+#ifdef _WIN32
+        std::vector<std::string> pending{mFolderPath.str()};
 
-            std::string path(file.path);
-            size_t last = path.size() - 1;
+        while(!pending.empty())
+        {
+            std::string folderPath = std::move(pending.back());
+            pending.pop_back();
+
+            scanFolder(folderPath, [&] (std::string path, bool isDirectory)
+            {
+                function(path, isDirectory);
 
-            bool skip = false;
+                if(isDirectory)
+                    pending.push_back(std::move(path));
+            });
+        }
+#else
+        //depth first with one open folder per level. subfolders are opened relative to their parent, so the full path is never resolved again
+        struct Folder
+        {
+            DIR* directory;
+            std::string path;
+        };
 
-            if(path[last] == '.')
+        struct FolderStack
+        {
+            ~FolderStack()
             {
-                if(path[last - 1] == '/')
-                    skip = true;
-                else if(path[last - 1] == '.' && path[last - 2] == '/')
-                    skip = true;
+                for(auto& folder : folders)
+                    closedir(folder.directory);
             }
 
-            if(skip)
+            std::vector<Folder> folders;
+        } stack;
+
+        DIR* root = opendir(mFolderPath.str().c_str());
+
+        if(!root)
+            throw InvalidFileException("given path '" + mFolderPath.str() + "' is not a valid directory");
+
+        stack.folders.push_back(Folder{root, mFolderPath.str()});
+
+        while(!stack.folders.empty())
+        {
+            DIR* directory = stack.folders.back().directory;
+            dirent* entry = readdir(directory);
+
+            if(!entry)
             {
+                closedir(directory);
+                stack.folders.pop_back();
                 continue;
             }
 
-            if(file.is_dir)
+            if(isDots(entry->d_name))
+                continue;
+
+            bool isDirectory = entry->d_type == DT_DIR;
+
+            //not every file system fills in the type, and links are followed like tinydir does
+            if(entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
             {
-                fetchFilesRecursively(path, output);
+                struct stat status;
+                isDirectory = fstatat(dirfd(directory), entry->d_name, &status, 0) == 0 && S_ISDIR(status.st_mode);
             }
 
-            if(mMode == FILES)
+            std::string path = stack.folders.back().path + '/' + entry->d_name;
+
+            function(path, isDirectory);
+
+            if(isDirectory)
             {
-                if(!file.is_dir)
-                    output.push_back(path);
+                int descriptor = openat(dirfd(directory), entry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                DIR* subfolder = descriptor != -1 ? fdopendir(descriptor) : nullptr;
+
+                if(!subfolder)
+                {
+                    if(descriptor != -1)
+                        close(descriptor);
+
+                    throw InvalidFileException("given path '" + path + "' is not a valid directory");
+                }
+
+                stack.folders.push_back(Folder{subfolder, std::move(path)});
             }
-            else if(mMode == FOLDERS)
+        }
+#endif
+    }
+
+    inline bool FileLister::wanted(Mode mode, bool isDirectory)
+    {
+        return mode == ALL || (mode == FOLDERS) == isDirectory;
+    }
+
+    inline bool FileLister::isDots(const char* name)
+    {
+        return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+    }
+
+    template <typename Function>
+    void FileLister::scanFolder(const std::string& folderPath, Function&& function)
+    {
+#ifdef _WIN32
+        tinydir_dir folder;
+        int32_t result = tinydir_open(&folder, folderPath.c_str());
+
+        if(result != 0)
+            throw InvalidFileException("given path '" + folderPath + "' is not a valid directory");
+
+        while(folder.has_next)
+        {
+            tinydir_file file;
+            tinydir_readfile(&folder, &file);
+            tinydir_next(&folder);
+
+            if(!isDots(file.name))
+                function(std::string(file.path), file.is_dir != 0);
+        }
+
+        tinydir_close(&folder);
+#else
+        DIR* directory = opendir(folderPath.c_str());
+
+        if(!directory)
+            throw InvalidFileException("given path '" + folderPath + "' is not a valid directory");
+
+        while(dirent* entry = readdir(directory))
+        {
+            if(isDots(entry->d_name))
+                continue;
+
+            bool isDirectory = entry->d_type == DT_DIR;
+
+            if(entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
             {
-                if(file.is_dir)
-                    output.push_back(path);
+                struct stat status;
+                isDirectory = fstatat(dirfd(directory), entry->d_name, &status, 0) == 0 && S_ISDIR(status.st_mode);
             }
-            else if(mMode == ALL)
+
+            function(folderPath + '/' + entry->d_name, isDirectory);
+        }
+
+        closedir(directory);
+#endif
+    }
+
+#ifndef REX_DISABLE_ASYNC
+    inline void FileLister::scanParallel(std::shared_ptr<ParallelScan> scan, std::string folderPath)
+    {
+        std::vector<Path> found;
+
+        try
+        {
+            scanFolder(folderPath, [&scan, &found] (std::string path, bool isDirectory)
             {
-                output.push_back(path);
-            }
+                if(isDirectory)
+                {
+                    ++scan->outstanding;
+
+                    try
+                    {
+                        scan->pool->enqueue([scan, path] ()
+                        {
+                            scanParallel(scan, path);
+                        }, 0);
+                    }
+                    catch(...)
+                    {
+                        --scan->outstanding;
+                        throw;
+                    }
+                }
+
+                if(wanted(scan->mode, isDirectory))
+                    found.emplace_back(std::move(path));
+            });
         }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(scan->mutex);
 
-        tinydir_close(&folder);
+            if(!scan->error)
+                scan->error = std::current_exception();
+        }
+
+        if(!found.empty())
+        {
+            std::lock_guard<std::mutex> lock(scan->mutex);
+            scan->result.insert(scan->result.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+        }
+
+        if(--scan->outstanding == 0)
+            scan->done.set_value();
     }
+#endif
 }
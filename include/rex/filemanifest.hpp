@@ -0,0 +1,148 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include <rex/binary.hpp>
+#include <rex/exceptions.hpp>
+#include <rex/mappedfile.hpp>
+#include <rex/path.hpp>
+
+namespace rex
+{
+    //remembers what a FileSource found in a folder, so that later runs can skip scanning it for as long as none of its folders were modified. adding, removing or renaming a file always modifies the folder it is in
+    class FileManifest
+    {
+        public:
+            using FolderStamps = std::vector<std::pair<std::string, int64_t>>;
+            static constexpr uint32_t Version = 1;
+            //gives false when there is no manifest for the key, or when any of the folders changed since it was written
+            static bool read(const Path& manifestPath, const std::string& key, std::unordered_map<std::string, Path>& files);
+            //best effort, since a manifest that can't be written only means that the next run scans again
+            static void write(const Path& manifestPath, const std::string& key, const FolderStamps& folders, const std::unordered_map<std::string, Path>& files);
+            //modification time of a folder in nanoseconds, or -1 if it can't be read
+            static int64_t folderStamp(const std::string& folderPath);
+    };
+
+    namespace manifest
+    {
+        const char Magic[4] = {'R', 'E', 'X', 'M'};
+    }
+
+    inline bool FileManifest::read(const Path& manifestPath, const std::string& key, std::unordered_map<std::string, Path>& files)
+    {
+        try
+        {
+            MappedFile file(manifestPath);
+            binary::Reader reader(file.data(), file.size());
+
+            for(char magic : manifest::Magic)
+            {
+                if(reader.number(1) != static_cast<unsigned char>(magic))
+                    return false;
+            }
+
+            if(reader.number(4) != Version || reader.string() != key || reader.failed())
+                return false;
+
+            uint64_t folderCount = reader.number(4);
+
+            for(uint64_t i = 0; i < folderCount && !reader.failed(); ++i)
+            {
+                std::string folderPath = reader.string();
+                int64_t stamp = static_cast<int64_t>(reader.number(8));
+
+                if(reader.failed() || stamp == -1 || folderStamp(folderPath) != stamp)
+                    return false;
+            }
+
+            uint64_t fileCount = reader.number(4);
+            std::unordered_map<std::string, Path> result;
+
+            for(uint64_t i = 0; i < fileCount && !reader.failed(); ++i)
+            {
+                std::string name = reader.string();
+                std::string path = reader.string();
+
+                if(!reader.failed())
+                    result.emplace(std::move(name), Path(std::move(path)));
+            }
+
+            if(reader.failed())
+                return false;
+
+            files = std::move(result);
+            return true;
+        }
+        catch(const InvalidFileException&)
+        {
+            return false;
+        }
+    }
+
+    inline void FileManifest::write(const Path& manifestPath, const std::string& key, const FolderStamps& folders, const std::unordered_map<std::string, Path>& files)
+    {
+        //written aside and moved in place so that a concurrent reader never sees half of it
+        std::string temporaryPath = manifestPath.str() + ".tmp";
+
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+
+            if(!out)
+                return;
+
+            out.write(manifest::Magic, 4);
+            binary::writeNumber(out, Version, 4);
+            binary::writeString(out, key);
+            binary::writeNumber(out, folders.size(), 4);
+
+            for(const auto& folder : folders)
+            {
+                binary::writeString(out, folder.first);
+                binary::writeNumber(out, static_cast<uint64_t>(folder.second), 8);
+            }
+
+            binary::writeNumber(out, files.size(), 4);
+
+            for(const auto& file : files)
+            {
+                binary::writeString(out, file.first);
+                binary::writeString(out, file.second.str());
+            }
+
+            if(!out)
+            {
+                out.close();
+                std::remove(temporaryPath.c_str());
+                return;
+            }
+        }
+
+#ifdef _WIN32
+        std::remove(manifestPath.str().c_str());
+#endif
+        if(std::rename(temporaryPath.c_str(), manifestPath.str().c_str()) != 0)
+            std::remove(temporaryPath.c_str());
+    }
+
+    inline int64_t FileManifest::folderStamp(const std::string& folderPath)
+    {
+        struct stat status;
+
+        if(stat(folderPath.c_str(), &status) != 0)
+            return -1;
+
+#if defined(__APPLE__)
+        return static_cast<int64_t>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+        return static_cast<int64_t>(status.st_mtime) * 1000000000;
+#else
+        return static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+    }
+}
@@ -1,49 +1,60 @@
 #pragma once
-#include <regex>
 #include <string>
 #include <unordered_map>
 #include <rex/config.hpp>
 #include <rex/exceptions.hpp>
 #include <rex/filelister.hpp>
+#include <rex/filemanifest.hpp>
+#include <rex/filter.hpp>
 
 namespace rex
 {
     enum class Naming { NO_EXT, FILE_NAME, PATH };
 
+    std::string resourceName(const Path& path, Naming naming);
+
     template <typename ResourceType>
     class FileSource
     {
         public:
-            FileSource(const Path& folder, const std::regex& regex = std::regex(".*"), Naming naming = Naming::NO_EXT);
+            FileSource(const Path& folder, const Filter& filter = Filter(), Naming naming = Naming::NO_EXT);
+            //keeps what was found in a manifest file, and reuses it instead of scanning as long as the folders stay unmodified. filters without a description are always scanned
+            FileSource(const Path& folder, const Filter& filter, Naming naming, const Path& manifestPath);
             ResourceType load(const std::string& id) const;
             std::vector<std::string> list() const;
+            //the file that a resource is loaded from
+            std::string filePath(const std::string& id) const;
         protected:
             virtual ResourceType loadFromFile(const Path& path) const = 0;
             std::string extractName(const Path& path, Naming naming);
             std::unordered_map<std::string, Path> mFiles;
+        private:
+            void scan(const Path& folder, const Filter& filter, Naming naming, FileManifest::FolderStamps* folders);
     };
 
     template <typename ResourceType>
-    FileSource<ResourceType>::FileSource(const Path& folder, const std::regex& regex, Naming naming)
+    FileSource<ResourceType>::FileSource(const Path& folder, const Filter& filter, Naming naming)
     {
-        FileLister lister(folder, FileLister::FILES);
-        auto pathList = lister.list();
+        scan(folder, filter, naming, nullptr);
+    }
 
-        for(const auto& path : pathList)
+    template <typename ResourceType>
+    FileSource<ResourceType>::FileSource(const Path& folder, const Filter& filter, Naming naming, const Path& manifestPath)
+    {
+        if(filter.description().empty())
         {
-            if(std::regex_match(path.str(), regex))
-            {
-                std::string name = extractName(path.str(), naming);
-
-                if(mFiles.count(name) == 0)
-                    mFiles.emplace(name, path);
-                else
-                {
-                    std::string collidingPath = mFiles.at(name);
-                    throw AmbiguousNameException("FileSource loading from '" + folder.str() + "' encountered name collision between '" + path.str() + "' and '" + collidingPath + "' which both result in the name '" + name + "'. Change the naming strategy of the FileSource or rename your files.");
-                }
-            }
+            scan(folder, filter, naming, nullptr);
+            return;
         }
+
+        std::string key = folder.str() + '\n' + filter.description() + '\n' + std::to_string(static_cast<int32_t>(naming));
+
+        if(FileManifest::read(manifestPath, key, mFiles))
+            return;
+
+        FileManifest::FolderStamps folders;
+        scan(folder, filter, naming, &folders);
+        FileManifest::write(manifestPath, key, folders, mFiles);
     }
 
     template <typename ResourceType>
@@ -70,8 +81,57 @@ namespace rex
         return result;
     }
 
+    template <typename ResourceType>
+    std::string FileSource<ResourceType>::filePath(const std::string& id) const
+    {
+        auto fileIter = mFiles.find(id);
+
+        if(fileIter == mFiles.end())
+            throw rex::InvalidResourceException("With resource '" + id + "', there is no such file");
+
+        return fileIter->second.str();
+    }
+
+    template <typename ResourceType>
+    void FileSource<ResourceType>::scan(const Path& folder, const Filter& filter, Naming naming, FileManifest::FolderStamps* folders)
+    {
+        FileLister lister(folder, FileLister::FILES);
+
+        //stamped before they are read, so that changes made during the scan are caught by the next run
+        if(folders)
+            folders->emplace_back(folder.str(), FileManifest::folderStamp(folder.str()));
+
+        //paths are only built for the files that match
+        lister.forEachEntry([&] (const std::string& filePath, bool isDirectory)
+        {
+            if(isDirectory)
+            {
+                if(folders)
+                    folders->emplace_back(filePath, FileManifest::folderStamp(filePath));
+            }
+            else if(filter.matches(filePath))
+            {
+                Path path(filePath);
+                std::string name = extractName(path, naming);
+
+                if(mFiles.count(name) == 0)
+                    mFiles.emplace(name, std::move(path));
+                else
+                {
+                    std::string collidingPath = mFiles.at(name);
+                    throw AmbiguousNameException("FileSource loading from '" + folder.str() + "' encountered name collision between '" + path.str() + "' and '" + collidingPath + "' which both result in the name '" + name + "'. Change the naming strategy of the FileSource or rename your files.");
+                }
+            }
+        });
+    }
+
     template <typename ResourceType>
     std::string FileSource<ResourceType>::extractName(const Path& path, Naming naming)
+    {
+        return resourceName(path, naming);
+    }
+
+    inline std::string resourceName(const Path& path, Naming naming)
     {
         if(naming == Naming::NO_EXT)
         {
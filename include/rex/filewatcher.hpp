@@ -0,0 +1,285 @@
+#pragma once
+#include <rex/config.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <rex/filemanifest.hpp>
+#include <rex/path.hpp>
+
+#if defined(__linux__) && !defined(REX_DISABLE_INOTIFY) && defined(__has_include)
+#if __has_include(<sys/inotify.h>)
+#define REX_INOTIFY
+#endif
+#endif
+
+#ifdef REX_INOTIFY
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace rex
+{
+    //tells when watched files are written or replaced. on linux, a thread sleeps on inotify until something happens. elsewhere, or where inotify is not available, the modification times of the files are compared every interval
+    class FileWatcher
+    {
+        public:
+            enum class Backend { INOTIFY, POLLING };
+            //called on the thread of the watcher with the path as it was given to watch, so it should hand the work on rather than do it
+            using Callback = std::function<void(const std::string&)>;
+            //changes that come in within the same interval are told about once
+            FileWatcher(Callback changed, std::chrono::milliseconds interval = std::chrono::milliseconds(250), Backend preferred = Backend::INOTIFY);
+            FileWatcher(const FileWatcher& other) = delete;
+            FileWatcher& operator=(const FileWatcher& other) = delete;
+            ~FileWatcher();
+            //watching a path twice does nothing
+            void watch(const std::string& path);
+            Backend backend() const;
+        private:
+            void work();
+            //the paths of files that changed since the last look, each once
+            std::vector<std::string> pollStamps();
+
+            Callback mChanged;
+            std::chrono::milliseconds mInterval;
+            Backend mBackend;
+            std::mutex mMutex;
+            std::condition_variable mCondition;
+            bool mStop;
+            //modification times of the files that are polled
+            std::unordered_map<std::string, int64_t> mStamps;
+#ifdef REX_INOTIFY
+            //inotify watches folders rather than files, since editors often save by replacing the file
+            std::vector<std::string> readNotifications();
+
+            int mNotify;
+            //written to when the watcher stops, to wake the thread
+            int mWake[2];
+            //watched file names by the watch descriptor of their folder, and the paths they were given as
+            std::unordered_map<int, std::unordered_map<std::string, std::string>> mFiles;
+#endif
+            std::thread mThread;
+    };
+
+    inline FileWatcher::FileWatcher(Callback changed, std::chrono::milliseconds interval, Backend preferred):
+        mChanged(std::move(changed)),
+        mInterval(interval),
+        mBackend(Backend::POLLING),
+        mStop(false)
+    {
+#ifdef REX_INOTIFY
+        mNotify = -1;
+        mWake[0] = -1;
+        mWake[1] = -1;
+
+        if(preferred == Backend::INOTIFY)
+        {
+            mNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+            if(mNotify != -1 && pipe2(mWake, O_CLOEXEC) == 0)
+            {
+                mBackend = Backend::INOTIFY;
+            }
+            else if(mNotify != -1)
+            {
+                close(mNotify);
+                mNotify = -1;
+            }
+        }
+#endif
+
+        mThread = std::thread(&FileWatcher::work, this);
+    }
+
+    inline FileWatcher::~FileWatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+
+        mCondition.notify_all();
+
+#ifdef REX_INOTIFY
+        if(mBackend == Backend::INOTIFY)
+        {
+            char wake = 0;
+
+            while(write(mWake[1], &wake, 1) == -1 && errno == EINTR)
+            {
+            }
+        }
+#endif
+
+        mThread.join();
+
+#ifdef REX_INOTIFY
+        if(mBackend == Backend::INOTIFY)
+        {
+            close(mNotify);
+            close(mWake[0]);
+            close(mWake[1]);
+        }
+#endif
+    }
+
+    inline void FileWatcher::watch(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+#ifdef REX_INOTIFY
+        if(mBackend == Backend::INOTIFY)
+        {
+            Path filePath(path);
+            std::string fileName = filePath.fileName();
+            std::string folder = filePath.str().substr(0, filePath.str().size() - fileName.size());
+
+            if(folder.empty())
+                folder = ".";
+
+            //the same folder always gives the same descriptor, so its files end up together
+            int watch = inotify_add_watch(mNotify, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+            if(watch != -1)
+            {
+                mFiles[watch].emplace(std::move(fileName), path);
+                return;
+            }
+        }
+#endif
+
+        //also where inotify can't watch the folder, for instance because there are too many watches already
+        if(mStamps.count(path) == 0)
+            mStamps.emplace(path, FileManifest::folderStamp(path));
+    }
+
+    inline FileWatcher::Backend FileWatcher::backend() const
+    {
+        return mBackend;
+    }
+
+    inline void FileWatcher::work()
+    {
+        while(true)
+        {
+            std::vector<std::string> changed;
+
+#ifdef REX_INOTIFY
+            if(mBackend == Backend::INOTIFY)
+            {
+                pollfd waited[2] = {{mNotify, POLLIN, 0}, {mWake[0], POLLIN, 0}};
+
+                //waiting on inotify alone would leave files that fell back to polling unchecked
+                if(poll(waited, 2, static_cast<int>(mInterval.count())) > 0 && (waited[0].revents & POLLIN))
+                {
+                    //an editor usually touches a file a few times when saving it, so these are gathered for a moment
+                    std::this_thread::sleep_for(mInterval / 10);
+                    changed = readNotifications();
+                }
+            }
+            else
+#endif
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait_for(lock, mInterval, [this] () { return mStop; });
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                if(mStop)
+                    return;
+            }
+
+            std::vector<std::string> polled = pollStamps();
+            changed.insert(changed.end(), std::make_move_iterator(polled.begin()), std::make_move_iterator(polled.end()));
+
+            for(const std::string& path : changed)
+                mChanged(path);
+        }
+    }
+
+    inline std::vector<std::string> FileWatcher::pollStamps()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<std::string> changed;
+
+        for(auto& stamp : mStamps)
+        {
+            int64_t current = FileManifest::folderStamp(stamp.first);
+
+            if(current != stamp.second)
+            {
+                stamp.second = current;
+
+                //a file that is gone can't be loaded again, so only its return is told about
+                if(current != -1)
+                    changed.push_back(stamp.first);
+            }
+        }
+
+        return changed;
+    }
+
+#ifdef REX_INOTIFY
+    inline std::vector<std::string> FileWatcher::readNotifications()
+    {
+        std::vector<std::string> changed;
+        alignas(inotify_event) char buffer[4096];
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        while(true)
+        {
+            ssize_t length = read(mNotify, buffer, sizeof(buffer));
+
+            if(length <= 0)
+                break;
+
+            for(ssize_t offset = 0; offset < length;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                //events were dropped, so anything may have changed
+                if(event->mask & IN_Q_OVERFLOW)
+                {
+                    for(const auto& folder : mFiles)
+                    {
+                        for(const auto& file : folder.second)
+                            changed.push_back(file.second);
+                    }
+
+                    continue;
+                }
+
+                auto folderIter = mFiles.find(event->wd);
+
+                if(folderIter == mFiles.end() || event->len == 0)
+                    continue;
+
+                auto fileIter = folderIter->second.find(event->name);
+
+                if(fileIter != folderIter->second.end())
+                    changed.push_back(fileIter->second);
+            }
+        }
+
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+        return changed;
+    }
+#endif
+}
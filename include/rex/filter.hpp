@@ -0,0 +1,344 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rex
+{
+    //decides which paths a FileSource picks up. extensions, globs and prefixes are matched directly, and only what can't be expressed with those goes through std::regex
+    class Filter
+    {
+        public:
+            //matches everything
+            Filter();
+            Filter(const std::regex& regex);
+            //a regex pattern. the usual shapes like ".*", ".*\.png", ".*\.(png|jpg)" and "some/folder/.*" are recognised and matched without std::regex
+            Filter(const std::string& pattern);
+            Filter(const char* pattern);
+            //extensions are given without the dot
+            static Filter extensions(const std::vector<std::string>& extensions);
+            //'*' matches anything but '/', '**' matches anything and '?' matches a single character other than '/'. a glob without any '/' is matched against the file name only
+            static Filter glob(const std::string& pattern);
+            static Filter prefixes(const std::vector<std::string>& prefixes);
+            bool matches(const std::string& path) const;
+            //identifies what the filter matches, or is empty if that can't be told, as with filters made from a std::regex object
+            const std::string& description() const;
+        private:
+            enum class Kind { ALL, EXTENSIONS, GLOB, PREFIXES, REGEX };
+
+            struct PrefixNode
+            {
+                std::vector<std::pair<char, uint32_t>> children;
+                bool terminal;
+            };
+
+            void compilePattern(const std::string& pattern);
+            void addPrefix(const std::string& prefix);
+            bool matchesExtension(const std::string& path) const;
+            bool matchesGlob(const std::string& path) const;
+            bool matchesPrefix(const std::string& path) const;
+            static bool isPlain(const std::string& text, bool allowSlash);
+
+            Kind mKind;
+            std::string mDescription;
+            std::vector<std::string> mExtensions;
+            std::string mGlob;
+            bool mGlobFileNameOnly;
+            std::vector<PrefixNode> mPrefixTree;
+            std::shared_ptr<const std::regex> mRegex;
+    };
+
+    inline Filter::Filter():
+        mKind(Kind::ALL),
+        mDescription("all"),
+        mGlobFileNameOnly(false)
+    {
+    }
+
+    inline Filter::Filter(const std::regex& regex):
+        mKind(Kind::REGEX),
+        mGlobFileNameOnly(false),
+        mRegex(std::make_shared<const std::regex>(regex))
+    {
+    }
+
+    inline Filter::Filter(const std::string& pattern):
+        Filter()
+    {
+        compilePattern(pattern);
+    }
+
+    inline Filter::Filter(const char* pattern):
+        Filter(std::string(pattern))
+    {
+    }
+
+    inline Filter Filter::extensions(const std::vector<std::string>& extensions)
+    {
+        Filter filter;
+        filter.mKind = Kind::EXTENSIONS;
+        filter.mExtensions = extensions;
+        filter.mDescription = "extensions:";
+
+        for(const auto& extension : extensions)
+            filter.mDescription += extension + "|";
+
+        return filter;
+    }
+
+    inline Filter Filter::glob(const std::string& pattern)
+    {
+        Filter filter;
+        filter.mKind = Kind::GLOB;
+        filter.mGlob = pattern;
+        filter.mGlobFileNameOnly = pattern.find('/') == std::string::npos;
+        filter.mDescription = "glob:" + pattern;
+
+        return filter;
+    }
+
+    inline Filter Filter::prefixes(const std::vector<std::string>& prefixes)
+    {
+        Filter filter;
+        filter.mKind = Kind::PREFIXES;
+        filter.mPrefixTree.push_back(PrefixNode{{}, false});
+        filter.mDescription = "prefixes:";
+
+        for(const auto& prefix : prefixes)
+        {
+            filter.addPrefix(prefix);
+            filter.mDescription += prefix + "|";
+        }
+
+        return filter;
+    }
+
+    inline bool Filter::matches(const std::string& path) const
+    {
+        switch(mKind)
+        {
+            case Kind::ALL:
+                return true;
+            case Kind::EXTENSIONS:
+                return matchesExtension(path);
+            case Kind::GLOB:
+                return matchesGlob(path);
+            case Kind::PREFIXES:
+                return matchesPrefix(path);
+            case Kind::REGEX:
+                return std::regex_match(path, *mRegex);
+        }
+
+        return false;
+    }
+
+    inline const std::string& Filter::description() const
+    {
+        return mDescription;
+    }
+
+    inline void Filter::compilePattern(const std::string& pattern)
+    {
+        std::string description = "regex:" + pattern;
+
+        if(pattern == ".*")
+        {
+        }
+        else if(pattern.compare(0, 4, ".*\\.") == 0 && isPlain(pattern.substr(4), false))
+        {
+            *this = extensions({pattern.substr(4)});
+        }
+        else if(pattern.compare(0, 5, ".*\\.(") == 0 && pattern.back() == ')')
+        {
+            std::vector<std::string> alternatives;
+            std::string list = pattern.substr(5, pattern.size() - 6);
+            size_t start = 0;
+
+            for(size_t bar = list.find('|'); ; bar = list.find('|', start))
+            {
+                alternatives.push_back(list.substr(start, bar == std::string::npos ? std::string::npos : bar - start));
+
+                if(bar == std::string::npos)
+                    break;
+
+                start = bar + 1;
+            }
+
+            bool plain = true;
+
+            for(const auto& alternative : alternatives)
+                plain = plain && isPlain(alternative, false);
+
+            if(plain)
+                *this = extensions(alternatives);
+            else
+                *this = Filter(std::regex(pattern));
+        }
+        else if(pattern.size() > 2 && pattern.compare(pattern.size() - 2, 2, ".*") == 0 && isPlain(pattern.substr(0, pattern.size() - 2), true))
+        {
+            *this = prefixes({pattern.substr(0, pattern.size() - 2)});
+        }
+        else
+        {
+            *this = Filter(std::regex(pattern));
+        }
+
+        mDescription = std::move(description);
+    }
+
+    inline void Filter::addPrefix(const std::string& prefix)
+    {
+        uint32_t node = 0;
+
+        for(char character : prefix)
+        {
+            uint32_t next = 0;
+
+            for(const auto& child : mPrefixTree[node].children)
+            {
+                if(child.first == character)
+                    next = child.second;
+            }
+
+            if(next == 0)
+            {
+                next = static_cast<uint32_t>(mPrefixTree.size());
+                mPrefixTree[node].children.emplace_back(character, next);
+                mPrefixTree.push_back(PrefixNode{{}, false});
+            }
+
+            node = next;
+        }
+
+        mPrefixTree[node].terminal = true;
+    }
+
+    inline bool Filter::matchesExtension(const std::string& path) const
+    {
+        size_t dot = path.find_last_of("./");
+
+        if(dot == std::string::npos || path[dot] != '.')
+            return false;
+
+        size_t length = path.size() - dot - 1;
+
+        for(const auto& extension : mExtensions)
+        {
+            if(extension.size() == length && path.compare(dot + 1, length, extension) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    inline bool Filter::matchesGlob(const std::string& path) const
+    {
+        size_t start = 0;
+
+        if(mGlobFileNameOnly)
+        {
+            size_t slash = path.find_last_of('/');
+            start = slash == std::string::npos ? 0 : slash + 1;
+        }
+
+        const char* pattern = mGlob.data();
+        const char* patternEnd = pattern + mGlob.size();
+        const char* text = path.data() + start;
+        const char* textEnd = path.data() + path.size();
+
+        //greedy matching that backtracks to the latest '*', or to the latest '**' when a '*' would have to cross a '/'
+        const char* starPattern = nullptr;
+        const char* starText = nullptr;
+        const char* doubleStarPattern = nullptr;
+        const char* doubleStarText = nullptr;
+
+        while(text < textEnd)
+        {
+            if(pattern < patternEnd && *pattern == '*')
+            {
+                if(pattern + 1 < patternEnd && pattern[1] == '*')
+                {
+                    pattern += 2;
+                    doubleStarPattern = pattern;
+                    doubleStarText = text;
+                    starPattern = nullptr;
+                }
+                else
+                {
+                    ++pattern;
+                    starPattern = pattern;
+                    starText = text;
+                }
+            }
+            else if(pattern < patternEnd && (*pattern == '?' ? *text != '/' : *pattern == *text))
+            {
+                ++pattern;
+                ++text;
+            }
+            else if(starPattern && *starText != '/')
+            {
+                pattern = starPattern;
+                text = ++starText;
+            }
+            else if(doubleStarPattern)
+            {
+                pattern = doubleStarPattern;
+                text = ++doubleStarText;
+                starPattern = nullptr;
+            }
+            else
+                return false;
+        }
+
+        while(pattern < patternEnd && *pattern == '*')
+            ++pattern;
+
+        return pattern == patternEnd;
+    }
+
+    inline bool Filter::matchesPrefix(const std::string& path) const
+    {
+        uint32_t node = 0;
+
+        for(char character : path)
+        {
+            if(mPrefixTree[node].terminal)
+                return true;
+
+            uint32_t next = 0;
+
+            for(const auto& child : mPrefixTree[node].children)
+            {
+                if(child.first == character)
+                    next = child.second;
+            }
+
+            if(next == 0)
+                return false;
+
+            node = next;
+        }
+
+        return mPrefixTree[node].terminal;
+    }
+
+    inline bool Filter::isPlain(const std::string& text, bool allowSlash)
+    {
+        if(text.empty())
+            return false;
+
+        for(char character : text)
+        {
+            bool plain = (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9') || character == '_' || character == '-' || (allowSlash && character == '/');
+
+            if(!plain)
+                return false;
+        }
+
+        return true;
+    }
+}
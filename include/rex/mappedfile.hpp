@@ -0,0 +1,162 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <string>
+#include <rex/exceptions.hpp>
+#include <rex/path.hpp>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rex
+{
+    //read only view of a whole file, mapped straight from the page cache. empty files give a null pointer and a size of 0
+    class MappedFile
+    {
+        public:
+            MappedFile(const Path& path);
+            MappedFile(const MappedFile& other) = delete;
+            MappedFile& operator=(const MappedFile& other) = delete;
+            MappedFile(MappedFile&& other);
+            MappedFile& operator=(MappedFile&& other);
+            ~MappedFile();
+            const char* data() const;
+            size_t size() const;
+        private:
+            void unmap();
+            const char* mData;
+            size_t mSize;
+    };
+
+    inline MappedFile::MappedFile(const Path& path):
+        mData(nullptr),
+        mSize(0)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.str().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if(file == INVALID_HANDLE_VALUE)
+            throw InvalidFileException("cannot open file '" + path.str() + "'");
+
+        LARGE_INTEGER fileSize;
+
+        if(!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            throw InvalidFileException("cannot read the size of file '" + path.str() + "'");
+        }
+
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+
+        if(mSize > 0)
+        {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+            //the view keeps the mapping alive on its own
+            if(mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+
+            if(!view)
+                throw InvalidFileException("cannot map file '" + path.str() + "'");
+
+            mData = static_cast<const char*>(view);
+        }
+        else
+            CloseHandle(file);
+#else
+        int file = open(path.str().c_str(), O_RDONLY);
+
+        if(file == -1)
+            throw InvalidFileException("cannot open file '" + path.str() + "'");
+
+        struct stat status;
+
+        if(fstat(file, &status) == -1)
+        {
+            close(file);
+            throw InvalidFileException("cannot read the size of file '" + path.str() + "'");
+        }
+
+        mSize = static_cast<size_t>(status.st_size);
+
+        if(mSize > 0)
+        {
+            void* view = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+
+            //the mapping stays valid after the descriptor is closed
+            close(file);
+
+            if(view == MAP_FAILED)
+                throw InvalidFileException("cannot map file '" + path.str() + "'");
+
+            //loaders decode files front to back, so let the kernel read ahead aggressively
+            madvise(view, mSize, MADV_SEQUENTIAL);
+            mData = static_cast<const char*>(view);
+        }
+        else
+            close(file);
+#endif
+    }
+
+    inline MappedFile::MappedFile(MappedFile&& other):
+        mData(other.mData),
+        mSize(other.mSize)
+    {
+        other.mData = nullptr;
+        other.mSize = 0;
+    }
+
+    inline MappedFile& MappedFile::operator=(MappedFile&& other)
+    {
+        if(this != &other)
+        {
+            unmap();
+            mData = other.mData;
+            mSize = other.mSize;
+            other.mData = nullptr;
+            other.mSize = 0;
+        }
+
+        return *this;
+    }
+
+    inline MappedFile::~MappedFile()
+    {
+        unmap();
+    }
+
+    inline const char* MappedFile::data() const
+    {
+        return mData;
+    }
+
+    inline size_t MappedFile::size() const
+    {
+        return mSize;
+    }
+
+    inline void MappedFile::unmap()
+    {
+        if(!mData)
+            return;
+
+#ifdef _WIN32
+        UnmapViewOfFile(mData);
+#else
+        munmap(const_cast<char*>(mData), mSize);
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+}
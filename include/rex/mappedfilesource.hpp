@@ -0,0 +1,44 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <string>
+#include <rex/filesource.hpp>
+#include <rex/mappedfile.hpp>
+
+namespace rex
+{
+    //a FileSource that maps each file into memory and lets the loader decode it in place instead of reading it through a stream
+    template <typename ResourceType>
+    class MappedFileSource : public FileSource<ResourceType>
+    {
+        public:
+            using FileSource<ResourceType>::FileSource;
+            //decodes a file that was already read, which lets a ResourceProvider read the files of a batch in the background and only decode on its workers
+            ResourceType decode(const std::string& id, const char* data, size_t size) const;
+        protected:
+            ResourceType loadFromFile(const Path& path) const override;
+            //the memory is only valid during the call, so resources that keep referring to it must copy what they need
+            virtual ResourceType loadFromMemory(const char* data, size_t size) const = 0;
+    };
+
+    template <typename ResourceType>
+    ResourceType MappedFileSource<ResourceType>::loadFromFile(const Path& path) const
+    {
+        MappedFile file(path);
+
+        return loadFromMemory(file.data(), file.size());
+    }
+
+    template <typename ResourceType>
+    ResourceType MappedFileSource<ResourceType>::decode(const std::string& id, const char* data, size_t size) const
+    {
+        try
+        {
+            return loadFromMemory(data, size);
+        }
+        catch(const std::exception& e)
+        {
+            throw rex::InvalidResourceException("With resource '" + id + "', " + e.what());
+        }
+    }
+}
@@ -1,9 +1,12 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <rex/asyncresourceview.hpp>
+#include <rex/completionqueue.hpp>
 
 namespace rex
 {
+    //finished loads are pushed to a queue by the loading threads, so polling only costs as much as what finished since the last poll
     class OnLoaded
     {
         public:
@@ -11,7 +14,16 @@ namespace rex
             OnLoaded(std::vector<AsyncResourceView<ResourceType>> toTrack, std::function<void(const std::string&, const decltype(toTrack[0].future.get())&)> callback);
             void poll();
         private:
+            struct Completions : LoadListener
+            {
+                void finished(size_t index, bool failed) override;
+                CompletionQueue queue;
+            };
+
             std::vector<bool> mDoneEntries;
+            std::shared_ptr<Completions> mCompleted;
+            //views without a handle can't be listened to, so they are checked on every poll. without async loading none of them are listened to
+            std::vector<size_t> mUnwatched;
             th::Any mToTrack;
             th::Any mCallback;
 
@@ -22,9 +34,38 @@ namespace rex
     template <typename ResourceType>
     OnLoaded::OnLoaded(std::vector<AsyncResourceView<ResourceType>> toTrack, std::function<void(const std::string&, const decltype(toTrack[0].future.get())&)> callback):
         mDoneEntries(toTrack.size(), false),
+        mCompleted(std::make_shared<Completions>()),
         mToTrack(std::move(toTrack)),
         mCallback(std::move(callback))
     {
+        const auto& tracked = mToTrack.get<std::vector<AsyncResourceView<ResourceType>>>();
+
+        for(size_t i = 0; i < tracked.size(); ++i)
+        {
+#ifndef REX_DISABLE_ASYNC
+            ResourceEntry* entry = tracked[i].handle.mEntry.get();
+
+            if(entry)
+            {
+                //only loads in flight are listened to, since a subscription is only let go of by the next load of the resource
+                if(tracked[i].future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready)
+                {
+                    mCompleted->queue.push(i);
+                    continue;
+                }
+
+                //checked again after listening, so a load finishing in between is seen by at least one of the two. poll skips the duplicate
+                entry->listen(mCompleted, i);
+
+                if(tracked[i].future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready)
+                    mCompleted->queue.push(i);
+
+                continue;
+            }
+#endif
+            mUnwatched.push_back(i);
+        }
+
         mEntryReady = [] (const th::Any& trackedAny, size_t index)
         {
             const auto& tracked = trackedAny.get<std::vector<AsyncResourceView<ResourceType>>>();
@@ -54,20 +95,30 @@ namespace rex
         };
     }
 
+    inline void OnLoaded::Completions::finished(size_t index, bool failed)
+    {
+        queue.push(index);
+    }
+
     inline void OnLoaded::poll()
     {
-        for(size_t i = 0; i < mDoneEntries.size(); ++i)
+        mCompleted->queue.drain([this] (size_t i)
         {
-            bool entryDone = mDoneEntries[i];
+            if(!mDoneEntries[i])
+            {
+                mDoneEntries[i] = true;
 
-            if(!entryDone)
+                mExecuteCallback(mToTrack, i, mCallback);
+            }
+        });
+
+        for(size_t i : mUnwatched)
+        {
+            if(!mDoneEntries[i] && mEntryReady(mToTrack, i))
             {
-                if(mEntryReady(mToTrack, i))
-                {
-                    mDoneEntries[i] = true;
+                mDoneEntries[i] = true;
 
-                    mExecuteCallback(mToTrack, i, mCallback);
-                }
+                mExecuteCallback(mToTrack, i, mCallback);
             }
         }
     }
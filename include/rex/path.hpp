@@ -1,7 +1,12 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <rex/stringview.hpp>
 
 namespace rex
 {
+    //the path is kept in one string and its components are views into it, located by offsets so that copies stay valid
     class Path
     {
         public:
@@ -9,41 +14,41 @@ namespace rex
             Path(const char* path);
             operator const std::string&() const;
             const std::string& str() const;
-            const std::string& fileName() const;
-            const std::string& stem() const;
-            const std::string& extension() const;
+            StringView fileName() const;
+            StringView stem() const;
+            StringView extension() const;
         private:
-            std::string toGoodSlash(std::string path) const;
-            std::string stripTrailingSlash(std::string path) const;
-            size_t fileNameStart(const std::string& path) const;
-            size_t extensionStart(const std::string& fileName) const;
+            static void toGoodSlash(std::string& path);
+            static void stripTrailingSlash(std::string& path);
+            static size_t fileNameStart(const std::string& path);
+            static size_t extensionDot(const std::string& path, size_t fileStart);
 
             std::string mPath;
-            std::string mFileName;
-            std::string mStem;
-            std::string mExtension;
+            uint32_t mFileNameStart;
+            uint32_t mStemEnd;
+            uint32_t mExtensionStart;
     };
 
-    inline Path::Path(std::string path)
+    inline Path::Path(std::string path):
+        mPath(std::move(path))
     {
-        mPath = std::move(path);
-        mPath = toGoodSlash(mPath);
-        mPath = stripTrailingSlash(mPath);
+        toGoodSlash(mPath);
+        stripTrailingSlash(mPath);
 
         size_t fileStart = fileNameStart(mPath);
+        size_t dot = extensionDot(mPath, fileStart);
 
-        mFileName = mPath.substr(fileStart);
+        mFileNameStart = static_cast<uint32_t>(fileStart);
 
-        size_t _extensionStart = extensionStart(mFileName);
-
-        if(_extensionStart != std::string::npos)
+        if(dot != std::string::npos)
         {
-            mExtension = mFileName.substr(_extensionStart);
-            mStem = mFileName.substr(0, _extensionStart - 1); 
+            mStemEnd = static_cast<uint32_t>(dot);
+            mExtensionStart = static_cast<uint32_t>(dot + 1);
         }
         else
         {
-            mStem = mFileName; 
+            mStemEnd = static_cast<uint32_t>(mPath.size());
+            mExtensionStart = static_cast<uint32_t>(mPath.size());
         }
     }
 
@@ -63,44 +68,35 @@ namespace rex
         return *this;
     }
 
-    inline const std::string& Path::fileName() const
+    inline StringView Path::fileName() const
     {
-        return mFileName;
+        return StringView(mPath.data() + mFileNameStart, mPath.size() - mFileNameStart);
     }
 
-    inline const std::string& Path::stem() const
+    inline StringView Path::stem() const
     {
-        return mStem;
+        return StringView(mPath.data() + mFileNameStart, mStemEnd - mFileNameStart);
     }
 
-    inline const std::string& Path::extension() const
+    inline StringView Path::extension() const
     {
-        return mExtension;
+        return StringView(mPath.data() + mExtensionStart, mPath.size() - mExtensionStart);
     }
 
-    inline std::string Path::toGoodSlash(std::string path) const
+    inline void Path::toGoodSlash(std::string& path)
     {
-        for(size_t backslashPos = path.find_first_of('\\'); backslashPos != std::string::npos;)
-        {
-            path[backslashPos] = '/';
-            
-            backslashPos = path.find_first_of('\\');
-        }
-
-        return path;
+        std::replace(path.begin(), path.end(), '\\', '/');
     }
 
-    inline std::string Path::stripTrailingSlash(std::string path) const
+    inline void Path::stripTrailingSlash(std::string& path)
     {
-        bool endsWithSlash = path.back() == '/';
+        bool endsWithSlash = !path.empty() && path.back() == '/';
 
         if(endsWithSlash)
             path.pop_back();
-
-        return path;
     }
 
-    inline size_t Path::fileNameStart(const std::string& path) const
+    inline size_t Path::fileNameStart(const std::string& path)
     {
         size_t lastSlash = path.find_last_of('/');
 
@@ -110,17 +106,18 @@ namespace rex
             return 0;
     }
     
-    inline size_t Path::extensionStart(const std::string& fileName) const
+    inline size_t Path::extensionDot(const std::string& path, size_t fileStart)
     {
-        bool containsOtherThanDot = fileName.find_first_not_of('.') != std::string::npos;
+        //names made of only dots, like '.' and '..', have no extension
+        bool containsOtherThanDot = path.find_first_not_of('.', fileStart) != std::string::npos;
 
         if(!containsOtherThanDot)
             return std::string::npos;
 
-        size_t lastSlash = fileName.find_last_of('.');
+        size_t lastDot = path.find_last_of('.');
 
-        if(lastSlash != std::string::npos)
-            return lastSlash + 1;
+        if(lastDot != std::string::npos && lastDot >= fileStart)
+            return lastDot;
         else
             return std::string::npos;
     }
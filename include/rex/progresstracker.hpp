@@ -1,10 +1,13 @@
 #pragma once
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <rex/thero.hpp>
 #include <rex/asyncresourceview.hpp>
 
 namespace rex
 {
+    //loads count themselves as done or failed when they finish, so asking for the status doesn't look at every load
     class ProgressTracker
     {
         public:
@@ -35,9 +38,22 @@ namespace rex
             int32_t total() const;
             Status status() const;
         private:
+            struct Counters : LoadListener
+            {
+                Counters(size_t count);
+                void finished(size_t index, bool failed) override;
+                //a load can be counted both by its listener and by the check made when tracking starts, but only the first one counts
+                std::unique_ptr<std::atomic<bool>[]> counted;
+                std::atomic<int32_t> done;
+                std::atomic<int32_t> failed;
+            };
+
             int32_t mTotal;
             th::Any mToTrack;
-            Status (*mStatusGetter)(const th::Any&);
+            std::shared_ptr<Counters> mCounters;
+            //views without a handle can't be listened to, so they are checked on every status. without async loading none of them are listened to
+            std::vector<size_t> mUnwatched;
+            void (*mCheck)(const th::Any&, size_t, Counters&);
     };
 
     inline ProgressTracker::Status::Status(int32_t waiting, int32_t done, int32_t failed):
@@ -99,41 +115,51 @@ namespace rex
     template <typename ResourceType>
     ProgressTracker::ProgressTracker(std::vector<AsyncResourceView<ResourceType>> toTrack):
         mTotal(toTrack.size()),
-        mToTrack(std::move(toTrack))
+        mToTrack(std::move(toTrack)),
+        mCounters(std::make_shared<Counters>(mTotal))
     {
-        mStatusGetter = [] (const th::Any& trackedAny)
+        mCheck = [] (const th::Any& trackedAny, size_t index, Counters& counters)
         {
             const auto& tracked = trackedAny.get<std::vector<AsyncResourceView<ResourceType>>>();
+            const auto& future = tracked[index].future;
 
-            int32_t waiting = 0;
-            int32_t done = 0;
-            int32_t failed = 0;
+            if(future.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
+                return;
 
-            for(const auto& view : tracked)
+            try
             {
-                auto futureStatus = view.future.wait_for(std::chrono::milliseconds(0));
-                if(futureStatus == std::future_status::timeout)
-                    ++waiting;
-                else if(futureStatus == std::future_status::ready)
-                {
-                    try
-                    {
-                        view.future.get();
-                        ++done;
-                    }
-                    catch(...)
-                    {
-                        ++failed;
-                    }
-                }
+                future.get();
+                counters.finished(index, false);
+            }
+            catch(...)
+            {
+                counters.finished(index, true);
             }
-
-            return Status(
-                waiting,
-                done,
-                failed
-            );
         };
+
+        const auto& tracked = mToTrack.get<std::vector<AsyncResourceView<ResourceType>>>();
+
+        for(size_t i = 0; i < tracked.size(); ++i)
+        {
+#ifndef REX_DISABLE_ASYNC
+            ResourceEntry* entry = tracked[i].handle.mEntry.get();
+
+            if(entry)
+            {
+                //only loads in flight are listened to, since a subscription is only let go of by the next load of the resource
+                mCheck(mToTrack, i, *mCounters);
+
+                if(mCounters->counted[i])
+                    continue;
+
+                //checked again after listening, so a load finishing in between is seen by at least one of the two
+                entry->listen(mCounters, i);
+                mCheck(mToTrack, i, *mCounters);
+                continue;
+            }
+#endif
+            mUnwatched.push_back(i);
+        }
     }
 
     inline int32_t ProgressTracker::total() const
@@ -143,6 +169,39 @@ namespace rex
 
     inline ProgressTracker::Status ProgressTracker::status() const
     {
-        return mStatusGetter(mToTrack);
+        for(size_t index : mUnwatched)
+        {
+            if(!mCounters->counted[index])
+                mCheck(mToTrack, index, *mCounters);
+        }
+
+        int32_t done = mCounters->done;
+        int32_t failed = mCounters->failed;
+
+        return Status(
+            mTotal - done - failed,
+            done,
+            failed
+        );
+    }
+
+    inline ProgressTracker::Counters::Counters(size_t count):
+        counted(new std::atomic<bool>[count]),
+        done(0),
+        failed(0)
+    {
+        for(size_t i = 0; i < count; ++i)
+            counted[i] = false;
+    }
+
+    inline void ProgressTracker::Counters::finished(size_t index, bool failed)
+    {
+        if(counted[index].exchange(true))
+            return;
+
+        if(failed)
+            ++this->failed;
+        else
+            ++done;
     }
 }
@@ -0,0 +1,561 @@
+#pragma once
+#include <rex/config.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <rex/exceptions.hpp>
+
+#if defined(__linux__) && !defined(REX_DISABLE_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define REX_IO_URING
+#endif
+#endif
+
+#ifdef REX_IO_URING
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace rex
+{
+    //the whole content of a file, or the error that kept it from being read
+    struct FileRead
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        std::exception_ptr error;
+    };
+
+    //reads whole files in the background. on linux, a single thread keeps many reads in flight at once with io_uring. elsewhere, or where io_uring is not available, a few threads read with blocking calls
+    class ReadEngine
+    {
+        public:
+            enum class Backend { IO_URING, THREADS };
+            //reads mostly wait, so a few threads are enough to keep a disk busy
+            static constexpr size_t DefaultThreadCount = 4;
+            static constexpr size_t DefaultDepth = 256;
+            //called on a thread of the engine once the file is read, so it should hand the data on rather than work on it
+            using Completion = std::function<void(FileRead&)>;
+
+            struct Request
+            {
+                std::string path;
+                Completion done;
+            };
+
+            //the threads are only used without io_uring. the depth is how many reads io_uring keeps in flight
+            ReadEngine(size_t threadCount = DefaultThreadCount, size_t depth = DefaultDepth, Backend preferred = Backend::IO_URING);
+            ReadEngine(const ReadEngine& other) = delete;
+            ReadEngine& operator=(const ReadEngine& other) = delete;
+            //finishes every read that was submitted
+            ~ReadEngine();
+            //the requests are all started before any of them is waited on
+            void submit(std::vector<Request> requests);
+            Backend backend() const;
+        private:
+            static void readWhole(const std::string& path, FileRead& read);
+            void work();
+
+            Backend mBackend;
+            std::mutex mMutex;
+            std::condition_variable mCondition;
+            std::deque<Request> mRequests;
+            std::vector<std::thread> mThreads;
+            bool mStop;
+#ifdef REX_IO_URING
+            struct Ring
+            {
+                int fd;
+                void* sqRing;
+                size_t sqRingSize;
+                void* cqRing;
+                size_t cqRingSize;
+                io_uring_sqe* sqes;
+                size_t sqesSize;
+                unsigned* sqHead;
+                unsigned* sqTail;
+                unsigned sqMask;
+                unsigned* sqArray;
+                unsigned* cqHead;
+                unsigned* cqTail;
+                unsigned cqMask;
+                io_uring_cqe* cqes;
+                unsigned entries;
+            };
+
+            struct RingRead
+            {
+                int fd;
+                size_t offset;
+                //reads go through readv, which every kernel with io_uring has, while plain reads need linux 5.6. the kernel may look at this until the read completes
+                iovec vector;
+                Request request;
+                FileRead read;
+            };
+
+            using Finished = std::vector<std::pair<std::unique_ptr<RingRead>, std::exception_ptr>>;
+
+            bool openRing(size_t depth);
+            void closeRing();
+            //moves waiting reads into the ring for as long as there is room. the files are only opened then, and without the lock, so that no more of them are open than the ring holds
+            void fill();
+            //gives false for reads that are over before they start, because the file can't be opened or is empty
+            static bool openFile(RingRead& ringRead, std::exception_ptr& error);
+            //these need the lock, since the submitting threads and the reaping thread share the submission queue
+            void queueRead(RingRead* ringRead);
+            //submits the queued reads. when the kernel is only out of room for now they stay queued and the reaping thread tries again, other errors fail them
+            void enter(Finished& finished);
+            void failUnsubmitted(int error, Finished& finished);
+            void reap();
+            static void finish(Finished& finished);
+            static void finish(std::unique_ptr<RingRead> ringRead, std::exception_ptr error);
+
+            Ring mRing;
+            //reads that are waiting for room in the ring. their files are not opened yet
+            std::deque<std::unique_ptr<RingRead>> mWaiting;
+            size_t mInFlight;
+            //slots in the ring that are kept for reads whose files are being opened
+            size_t mOpening;
+            unsigned mUnsubmitted;
+            //reads the kernel has and hasn't completed yet. the reaping thread only sleeps in the kernel while there are some, and on the condition otherwise
+            size_t mSubmitted;
+#endif
+    };
+
+    inline ReadEngine::ReadEngine(size_t threadCount, size_t depth, Backend preferred):
+        mBackend(Backend::THREADS),
+        mStop(false)
+    {
+#ifdef REX_IO_URING
+        mInFlight = 0;
+        mOpening = 0;
+        mUnsubmitted = 0;
+        mSubmitted = 0;
+
+        if(preferred == Backend::IO_URING && openRing(depth))
+        {
+            mBackend = Backend::IO_URING;
+            mThreads.emplace_back(&ReadEngine::reap, this);
+            return;
+        }
+#endif
+
+        if(threadCount == 0)
+            threadCount = 1;
+
+        for(size_t i = 0; i < threadCount; ++i)
+            mThreads.emplace_back(&ReadEngine::work, this);
+    }
+
+    inline ReadEngine::~ReadEngine()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+
+        mCondition.notify_all();
+
+        for(auto& thread : mThreads)
+            thread.join();
+
+#ifdef REX_IO_URING
+        if(mBackend == Backend::IO_URING)
+            closeRing();
+#endif
+    }
+
+    inline void ReadEngine::submit(std::vector<Request> requests)
+    {
+#ifdef REX_IO_URING
+        if(mBackend == Backend::IO_URING)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                for(auto& request : requests)
+                    mWaiting.emplace_back(new RingRead{-1, 0, iovec{nullptr, 0}, std::move(request), FileRead{nullptr, 0, nullptr}});
+            }
+
+            fill();
+            return;
+        }
+#endif
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            for(auto& request : requests)
+                mRequests.push_back(std::move(request));
+        }
+
+        mCondition.notify_all();
+    }
+
+    inline ReadEngine::Backend ReadEngine::backend() const
+    {
+        return mBackend;
+    }
+
+    inline void ReadEngine::readWhole(const std::string& path, FileRead& read)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+        if(!file)
+            throw InvalidFileException("cannot open file '" + path + "'");
+
+        read.size = static_cast<size_t>(file.tellg());
+        read.data.reset(new char[read.size]);
+        file.seekg(0);
+
+        if(!file.read(read.data.get(), read.size))
+            throw InvalidFileException("cannot read file '" + path + "'");
+    }
+
+    inline void ReadEngine::work()
+    {
+        while(true)
+        {
+            Request request;
+
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this] { return mStop || !mRequests.empty(); });
+
+                if(mRequests.empty())
+                    return;
+
+                request = std::move(mRequests.front());
+                mRequests.pop_front();
+            }
+
+            FileRead read{nullptr, 0, nullptr};
+
+            try
+            {
+                readWhole(request.path, read);
+            }
+            catch(...)
+            {
+                read = FileRead{nullptr, 0, std::current_exception()};
+            }
+
+            request.done(read);
+        }
+    }
+
+#ifdef REX_IO_URING
+    inline bool ReadEngine::openRing(size_t depth)
+    {
+        io_uring_params parameters;
+        std::memset(&parameters, 0, sizeof(parameters));
+
+        mRing.fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(depth != 0 ? depth : 1), &parameters));
+
+        //not built into the kernel, or forbidden by a sandbox
+        if(mRing.fd < 0)
+            return false;
+
+        mRing.entries = parameters.sq_entries;
+        mRing.sqRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+        mRing.cqRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+        mRing.sqesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+
+        bool singleMap = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+        if(singleMap)
+            mRing.sqRingSize = mRing.cqRingSize = std::max(mRing.sqRingSize, mRing.cqRingSize);
+
+        mRing.sqRing = mmap(nullptr, mRing.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing.fd, IORING_OFF_SQ_RING);
+        mRing.cqRing = singleMap ? mRing.sqRing : mmap(nullptr, mRing.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing.fd, IORING_OFF_CQ_RING);
+        void* sqes = mmap(nullptr, mRing.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing.fd, IORING_OFF_SQES);
+
+        if(mRing.sqRing == MAP_FAILED || mRing.cqRing == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            if(mRing.sqRing != MAP_FAILED)
+                munmap(mRing.sqRing, mRing.sqRingSize);
+            if(!singleMap && mRing.cqRing != MAP_FAILED)
+                munmap(mRing.cqRing, mRing.cqRingSize);
+            if(sqes != MAP_FAILED)
+                munmap(sqes, mRing.sqesSize);
+            close(mRing.fd);
+            return false;
+        }
+
+        char* sqRing = static_cast<char*>(mRing.sqRing);
+        char* cqRing = static_cast<char*>(mRing.cqRing);
+        mRing.sqHead = reinterpret_cast<unsigned*>(sqRing + parameters.sq_off.head);
+        mRing.sqTail = reinterpret_cast<unsigned*>(sqRing + parameters.sq_off.tail);
+        mRing.sqMask = *reinterpret_cast<unsigned*>(sqRing + parameters.sq_off.ring_mask);
+        mRing.sqArray = reinterpret_cast<unsigned*>(sqRing + parameters.sq_off.array);
+        mRing.cqHead = reinterpret_cast<unsigned*>(cqRing + parameters.cq_off.head);
+        mRing.cqTail = reinterpret_cast<unsigned*>(cqRing + parameters.cq_off.tail);
+        mRing.cqMask = *reinterpret_cast<unsigned*>(cqRing + parameters.cq_off.ring_mask);
+        mRing.cqes = reinterpret_cast<io_uring_cqe*>(cqRing + parameters.cq_off.cqes);
+        mRing.sqes = static_cast<io_uring_sqe*>(sqes);
+
+        return true;
+    }
+
+    inline void ReadEngine::closeRing()
+    {
+        munmap(mRing.sqes, mRing.sqesSize);
+
+        if(mRing.cqRing != mRing.sqRing)
+            munmap(mRing.cqRing, mRing.cqRingSize);
+
+        munmap(mRing.sqRing, mRing.sqRingSize);
+        close(mRing.fd);
+    }
+
+    inline void ReadEngine::fill()
+    {
+        while(true)
+        {
+            std::vector<std::unique_ptr<RingRead>> opening;
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                //the completion queue is twice as big as the ring, so it never overflows
+                while(!mWaiting.empty() && mInFlight + mOpening < mRing.entries)
+                {
+                    opening.push_back(std::move(mWaiting.front()));
+                    mWaiting.pop_front();
+                    ++mOpening;
+                }
+            }
+
+            if(opening.empty())
+                return;
+
+            Finished finished;
+            std::vector<RingRead*> opened;
+
+            for(auto& ringRead : opening)
+            {
+                std::exception_ptr error;
+
+                if(openFile(*ringRead, error))
+                    opened.push_back(ringRead.release());
+                else
+                    finished.emplace_back(std::move(ringRead), error);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mOpening -= opening.size();
+
+                for(RingRead* ringRead : opened)
+                    queueRead(ringRead);
+
+                enter(finished);
+            }
+
+            //the reaping thread may wait on the condition, when the kernel had nothing
+            mCondition.notify_all();
+
+            //reads that are over free their slots again, so this goes on until the ring is full or nothing waits
+            finish(finished);
+        }
+    }
+
+    inline bool ReadEngine::openFile(RingRead& ringRead, std::exception_ptr& error)
+    {
+        ringRead.fd = open(ringRead.request.path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat status;
+
+        if(ringRead.fd == -1 || fstat(ringRead.fd, &status) == -1)
+        {
+            error = std::make_exception_ptr(InvalidFileException("cannot open file '" + ringRead.request.path + "'"));
+            return false;
+        }
+
+        ringRead.read.size = static_cast<size_t>(status.st_size);
+        ringRead.read.data.reset(new char[ringRead.read.size]);
+        return ringRead.read.size != 0;
+    }
+
+    inline void ReadEngine::queueRead(RingRead* ringRead)
+    {
+        unsigned tail = *mRing.sqTail;
+        unsigned index = tail & mRing.sqMask;
+        io_uring_sqe& entry = mRing.sqes[index];
+        size_t remaining = ringRead->read.size - ringRead->offset;
+
+        ringRead->vector.iov_base = ringRead->read.data.get() + ringRead->offset;
+        ringRead->vector.iov_len = std::min<size_t>(remaining, 1u << 30);
+
+        std::memset(&entry, 0, sizeof(entry));
+        entry.opcode = IORING_OP_READV;
+        entry.fd = ringRead->fd;
+        entry.addr = reinterpret_cast<uint64_t>(&ringRead->vector);
+        entry.len = 1;
+        entry.off = ringRead->offset;
+        entry.user_data = reinterpret_cast<uint64_t>(ringRead);
+
+        mRing.sqArray[index] = index;
+        __atomic_store_n(mRing.sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++mInFlight;
+        ++mUnsubmitted;
+    }
+
+    inline void ReadEngine::enter(Finished& finished)
+    {
+        while(mUnsubmitted != 0)
+        {
+            int result = static_cast<int>(syscall(__NR_io_uring_enter, mRing.fd, mUnsubmitted, 0, 0, nullptr, 0));
+
+            if(result < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+
+                if(errno != EAGAIN && errno != EBUSY)
+                    failUnsubmitted(errno, finished);
+
+                return;
+            }
+
+            mUnsubmitted -= std::min(mUnsubmitted, static_cast<unsigned>(result));
+            mSubmitted += static_cast<size_t>(result);
+
+            //the kernel takes fewer entries than asked when it runs out of room, and the rest are tried again later
+            return;
+        }
+    }
+
+    inline void ReadEngine::failUnsubmitted(int error, Finished& finished)
+    {
+        unsigned tail = *mRing.sqTail;
+
+        //the kernel only takes entries in io_uring_enter, so the ones it hasn't taken can be taken back from the end of the queue
+        for(unsigned i = 1; i <= mUnsubmitted; ++i)
+        {
+            RingRead* ringRead = reinterpret_cast<RingRead*>(mRing.sqes[mRing.sqArray[(tail - i) & mRing.sqMask]].user_data);
+            --mInFlight;
+            finished.emplace_back(std::unique_ptr<RingRead>(ringRead), std::make_exception_ptr(InvalidFileException("cannot read file '" + ringRead->request.path + "': " + std::strerror(error))));
+        }
+
+        __atomic_store_n(mRing.sqTail, tail - mUnsubmitted, __ATOMIC_RELEASE);
+        mUnsubmitted = 0;
+    }
+
+    inline void ReadEngine::reap()
+    {
+        while(true)
+        {
+            Finished finished;
+            bool completing = false;
+
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+
+                if(mStop && mInFlight == 0 && mOpening == 0 && mWaiting.empty())
+                    return;
+
+                //reads the kernel had no room for before are submitted again
+                enter(finished);
+
+                if(mSubmitted == 0 && finished.empty())
+                {
+                    if(mUnsubmitted != 0)
+                        mCondition.wait_for(lock, std::chrono::milliseconds(1));
+                    else
+                        mCondition.wait(lock, [this] { return mStop || mSubmitted != 0 || mUnsubmitted != 0; });
+                }
+
+                completing = mSubmitted != 0;
+            }
+
+            //only this thread waits for completions, so the ring can be waited on without the lock. there is always one to come, so it wakes up
+            if(completing)
+            {
+                int result = static_cast<int>(syscall(__NR_io_uring_enter, mRing.fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+
+                if(result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    std::this_thread::yield();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                unsigned head = *mRing.cqHead;
+                unsigned tail = __atomic_load_n(mRing.cqTail, __ATOMIC_ACQUIRE);
+
+                for(; head != tail; ++head)
+                {
+                    const io_uring_cqe& completion = mRing.cqes[head & mRing.cqMask];
+                    RingRead* ringRead = reinterpret_cast<RingRead*>(completion.user_data);
+                    --mSubmitted;
+                    --mInFlight;
+
+                    if(completion.res == -EINTR || completion.res == -EAGAIN)
+                    {
+                        queueRead(ringRead);
+                    }
+                    else if(completion.res < 0)
+                    {
+                        finished.emplace_back(std::unique_ptr<RingRead>(ringRead), std::make_exception_ptr(InvalidFileException("cannot read file '" + ringRead->request.path + "': " + std::strerror(-completion.res))));
+                    }
+                    else
+                    {
+                        ringRead->offset += static_cast<size_t>(completion.res);
+
+                        //a file that shrank since it was opened ends early
+                        if(completion.res == 0)
+                            ringRead->read.size = ringRead->offset;
+
+                        if(ringRead->offset < ringRead->read.size)
+                            queueRead(ringRead);
+                        else
+                            finished.emplace_back(std::unique_ptr<RingRead>(ringRead), nullptr);
+                    }
+                }
+
+                __atomic_store_n(mRing.cqHead, head, __ATOMIC_RELEASE);
+                enter(finished);
+            }
+
+            //the reads that are done make room for the waiting ones, and their files are closed before those are opened
+            finish(finished);
+            fill();
+        }
+    }
+
+    inline void ReadEngine::finish(Finished& finished)
+    {
+        for(auto& ringRead : finished)
+            finish(std::move(ringRead.first), ringRead.second);
+    }
+
+    inline void ReadEngine::finish(std::unique_ptr<RingRead> ringRead, std::exception_ptr error)
+    {
+        if(ringRead->fd != -1)
+            close(ringRead->fd);
+
+        if(error)
+            ringRead->read = FileRead{nullptr, 0, error};
+
+        ringRead->request.done(ringRead->read);
+    }
+#endif
+}
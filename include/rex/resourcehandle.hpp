@@ -0,0 +1,212 @@
+#pragma once
+#include <rex/config.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace rex
+{
+    //told by the loading thread once a load in flight is done, with the index it was registered with. without async loading nothing is ever told
+    class LoadListener
+    {
+        public:
+            virtual ~LoadListener();
+            virtual void finished(size_t index, bool failed) = 0;
+    };
+
+    inline LoadListener::~LoadListener()
+    {
+    }
+
+    //every resource id that a ResourceProvider has seen is interned as one of these. it stays put until its source is removed and no handle refers to it anymore
+    struct ResourceEntry
+    {
+        using ReleaseFunction = void(*)(ResourceEntry&);
+        ResourceEntry(std::string sourceId, std::string resourceId, ReleaseFunction release);
+#ifndef REX_DISABLE_ASYNC
+        ~ResourceEntry();
+        //the listener is told once the load in flight finishes, whether it succeeds or not. one added after that is only told by the next load
+        void listen(std::shared_ptr<LoadListener> listener, size_t index);
+        void notifyListeners(bool failed);
+#endif
+        void touch();
+        const std::string sourceId;
+        const std::string resourceId;
+        //points at the resident resource, or is null when it is not loaded
+        std::atomic<const void*> resource;
+        //amount of handles currently referring to this entry
+        std::atomic<int32_t> users;
+        //set on access and cleared by the eviction sweep, giving recently used resources a second chance
+        std::atomic<bool> referenced;
+        //set when the resource was marked as unused while there were handles to it
+        std::atomic<bool> unusedPending;
+        //set when a reload replaced the resource while there were handles to it, so that the last one frees the old versions
+        std::atomic<bool> replacedPending;
+        //called by the last handle to let go of an entry with a pending unuse
+        ReleaseFunction release;
+#ifndef REX_DISABLE_ASYNC
+        struct Subscription
+        {
+            std::shared_ptr<LoadListener> listener;
+            size_t index;
+            Subscription* next;
+        };
+
+        static void destroySubscriptions(Subscription* subscription);
+        std::atomic<Subscription*> subscriptions;
+#endif
+    };
+
+    //a resource is never evicted or freed while there is a handle to it. if it is marked as unused meanwhile, the last handle to let go of it frees it. handles share the ownership of the storage of their source, so they may outlive the removal of the source and the provider itself
+    template <typename ResourceType>
+    class ResourceHandle
+    {
+        public:
+            ResourceHandle();
+            ResourceHandle(const ResourceHandle& other);
+            ResourceHandle(ResourceHandle&& other);
+            ResourceHandle& operator=(ResourceHandle other);
+            ~ResourceHandle();
+            const std::string& sourceId() const;
+            const std::string& identifier() const;
+            bool valid() const;
+            bool loaded() const;
+        private:
+            ResourceHandle(std::shared_ptr<ResourceEntry> entry);
+            std::shared_ptr<ResourceEntry> mEntry;
+
+            friend class ResourceProvider;
+            friend class OnLoaded;
+            friend class ProgressTracker;
+    };
+
+    inline ResourceEntry::ResourceEntry(std::string sourceId, std::string resourceId, ReleaseFunction release):
+        sourceId(std::move(sourceId)),
+        resourceId(std::move(resourceId)),
+        resource(nullptr),
+        users(0),
+        referenced(false),
+        unusedPending(false),
+        replacedPending(false),
+        release(release)
+#ifndef REX_DISABLE_ASYNC
+        ,
+        subscriptions(nullptr)
+#endif
+    {
+    }
+
+#ifndef REX_DISABLE_ASYNC
+    inline ResourceEntry::~ResourceEntry()
+    {
+        destroySubscriptions(subscriptions.load());
+    }
+
+    inline void ResourceEntry::listen(std::shared_ptr<LoadListener> listener, size_t index)
+    {
+        Subscription* subscription = new Subscription{std::move(listener), index, subscriptions.load(std::memory_order_relaxed)};
+
+        while(!subscriptions.compare_exchange_weak(subscription->next, subscription))
+        {
+        }
+    }
+
+    inline void ResourceEntry::notifyListeners(bool failed)
+    {
+        Subscription* subscription = subscriptions.exchange(nullptr);
+
+        //cheap when nobody listens, which is the common case
+        if(!subscription)
+            return;
+
+        for(Subscription* current = subscription; current; current = current->next)
+            current->listener->finished(current->index, failed);
+
+        destroySubscriptions(subscription);
+    }
+
+    inline void ResourceEntry::destroySubscriptions(Subscription* subscription)
+    {
+        while(subscription)
+        {
+            Subscription* next = subscription->next;
+            delete subscription;
+            subscription = next;
+        }
+    }
+#endif
+
+    inline void ResourceEntry::touch()
+    {
+        //only write when needed, to not bounce the cache line between threads that read the same resource
+        if(!referenced.load(std::memory_order_relaxed))
+            referenced.store(true, std::memory_order_relaxed);
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType>::ResourceHandle()
+    {
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType>::ResourceHandle(const ResourceHandle& other):
+        ResourceHandle(other.mEntry)
+    {
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType>::ResourceHandle(ResourceHandle&& other):
+        mEntry(std::move(other.mEntry))
+    {
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType>& ResourceHandle<ResourceType>::operator=(ResourceHandle other)
+    {
+        std::swap(mEntry, other.mEntry);
+        return *this;
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType>::~ResourceHandle()
+    {
+        //the pending flags are set before the users are checked, so either this sees them or the provider sees no users. the entry itself is only let go of afterwards
+        if(mEntry && mEntry->users.fetch_sub(1) == 1 && (mEntry->unusedPending.load() || mEntry->replacedPending.load()))
+            mEntry->release(*mEntry);
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType>::ResourceHandle(std::shared_ptr<ResourceEntry> entry):
+        mEntry(std::move(entry))
+    {
+        if(mEntry)
+            mEntry->users.fetch_add(1);
+    }
+
+    template <typename ResourceType>
+    const std::string& ResourceHandle<ResourceType>::sourceId() const
+    {
+        return mEntry->sourceId;
+    }
+
+    template <typename ResourceType>
+    const std::string& ResourceHandle<ResourceType>::identifier() const
+    {
+        return mEntry->resourceId;
+    }
+
+    template <typename ResourceType>
+    bool ResourceHandle<ResourceType>::valid() const
+    {
+        return mEntry != nullptr;
+    }
+
+    template <typename ResourceType>
+    bool ResourceHandle<ResourceType>::loaded() const
+    {
+        return mEntry != nullptr && mEntry->resource.load(std::memory_order_acquire) != nullptr;
+    }
+}
@@ -2,20 +2,39 @@
 #include <rex/config.hpp>
 
 #ifndef REX_DISABLE_ASYNC
+#include <condition_variable>
+#include <future>
 #include <mutex>
+#include <unordered_set>
 #endif 
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 #include <rex/thero.hpp>
 
+#include <rex/arena.hpp>
 #include <rex/exceptions.hpp>
 #include <rex/exceptions.hpp>
+#include <rex/resourcehandle.hpp>
 #include <rex/resourceview.hpp>
+#include <rex/sourcetraits.hpp>
 #include <rex/sourceview.hpp>
 
 #ifndef REX_DISABLE_ASYNC
 #include <rex/asyncresourceview.hpp>
+#include <rex/filewatcher.hpp>
+#include <rex/readengine.hpp>
+#include <rex/sharedmutex.hpp>
 #include <rex/threadpool.hpp>
 #endif 
 
@@ -23,22 +42,190 @@ namespace rex
 {
     class ResourceProvider
     {
-        template<typename ResourceType>
-        using LoadingFunction = ResourceType(*)(const th::Any&, const std::string&);
         using ListingFunction = std::vector<std::string>(*)(const th::Any&);
-        using WaitFunction = void(*)(const th::Any&);
+
+        struct ResourceStorage;
+        struct SourceEntry;
+#ifndef REX_DISABLE_ASYNC
+        struct QueuedLoad;
+#endif
+
+        //the entry is the part that handles see, the rest is private to the provider
+        struct StoredResource : ResourceEntry
+        {
+            StoredResource(const std::string& sourceId, const std::string& resourceId, ResourceStorage& storage);
+            ResourceStorage& storage;
+            //the resource in the typed store of the source, or null when it is not loaded
+            void* value;
+            size_t size;
+#ifndef REX_DISABLE_ASYNC
+            //the future of a load in flight, kept in place since every shared_future of a reference has the same layout, which addSource checks
+            std::aligned_storage<sizeof(std::shared_future<const char&>), alignof(std::shared_future<const char&>)>::type asyncProcess;
+            bool loading;
+            //the latest lower detail version published by a progressive load, only set while that load runs. it is swapped atomically and not counted against the budget
+            std::shared_ptr<const void> partial;
+            //set while the load waits in the pool, so that it can be given another priority
+            std::shared_ptr<QueuedLoad> queued;
+            //versions that a reload replaced while handles pinned the resource, with their sizes. the last handle to let go frees them, and until then they count against the budget
+            std::vector<std::pair<void*, size_t>> replaced;
+#endif
+        };
+
+        struct ResourceShard
+        {
+#ifndef REX_DISABLE_ASYNC
+            //held by everything that starts, finishes or drops a load in this shard
+            std::recursive_mutex loadMutex;
+            //guards the table itself so that readers can share it. it is only taken exclusively while interning new ids
+            SharedMutex tableMutex;
+#endif
+            std::unordered_map<std::string, StoredResource> resources;
+        };
+
+        struct MemoryBudget
+        {
+            MemoryBudget();
+            std::atomic<size_t> usage;
+            std::atomic<size_t> budget;
+        };
+
+        //handles share the ownership of the storage, so that it outlives the source while they refer to it
+        struct ResourceStorage : std::enable_shared_from_this<ResourceStorage>
+        {
+            static constexpr size_t ShardCount = 16;
+            ResourceStorage(std::shared_ptr<MemoryBudget> memory);
+            virtual ~ResourceStorage();
+            //only the typed store knows the types of the resources and futures, so it is the one to get rid of them
+            virtual void destroyValue(StoredResource& stored) = 0;
+            //destroys every loaded resource and gives their memory back at once. every shard must be locked and no resource may be in use
+            virtual void destroyAllValues() = 0;
+#ifndef REX_DISABLE_ASYNC
+            virtual void clearAsyncProcess(StoredResource& stored) = 0;
+            virtual void destroyReplaced(StoredResource& stored) = 0;
+#endif
+            static size_t shardIndex(const std::string& resourceId);
+            ResourceShard& shard(const std::string& resourceId);
+            std::array<ResourceShard, ShardCount> shards;
+            std::atomic<size_t> usage;
+            std::atomic<size_t> budget;
+            //shard where the next eviction sweep starts
+            std::atomic<size_t> clockHand;
+            //the budget shared by all sources, kept here so that unloading doesn't need the provider
+            std::shared_ptr<MemoryBudget> memory;
+            //set for sources that opted in to an arena, which markAllUnused then releases as a whole
+            bool releasesInBulk;
+            //set once the source is removed, since its usage is then no longer part of the shared budget. only changed with every shard locked
+            bool detached;
+#ifndef REX_DISABLE_ASYNC
+            //reloads that are queued or running. they refer to the source, so it is only removed once they are done
+            std::mutex reloadMutex;
+            std::condition_variable reloadsDone;
+            size_t reloads;
+#endif
+        };
+
+        //holds the resources of one source by value in an arena, reusing the slots of unloaded ones
+        template <typename ResourceType>
+        struct TypedStore : ResourceStorage
+        {
+            using LoadingFunction = ResourceType(*)(const th::Any&, StoredResource&);
+            using DecodeFunction = ResourceType(*)(const th::Any&, const std::string&, const char*, size_t);
+            using SizeFunction = size_t(*)(const th::Any&, const ResourceType&);
+            //sources that don't ask for an arena get chunks of about the size std::deque uses
+            static constexpr size_t DefaultChunkBytes = 512;
+            //an arena chunk of 0 means that the source didn't opt in
+            TypedStore(std::shared_ptr<MemoryBudget> memory, LoadingFunction loadingFunction, DecodeFunction decodeFunction, SizeFunction sizeFunction, size_t arenaChunk);
+            ~TypedStore();
+            ResourceType* emplace(ResourceType&& resource);
+            void destroyValue(StoredResource& stored) override;
+            void destroyAllValues() override;
+#ifndef REX_DISABLE_ASYNC
+            void clearAsyncProcess(StoredResource& stored) override;
+            void destroyReplaced(StoredResource& stored) override;
+#endif
+            LoadingFunction loadingFunction;
+            //null for sources that aren't loaded in stages
+            DecodeFunction decodeFunction;
+            SizeFunction sizeFunction;
+#ifndef REX_DISABLE_ASYNC
+            //the arena is shared by all shards, so this is taken briefly on top of a shard lock
+            std::mutex arenaMutex;
+#endif
+            Arena<ResourceType> arena;
+        };
+
+        using WaitFunction = void(*)(const ResourceProvider&, ResourceShard&, const std::string&);
+        using DependencyFunction = std::vector<Dependency>(*)(const th::Any&, const std::string&);
+        //loads a resource of the source synchronously without the caller knowing its type
+        using FetchFunction = void(*)(const ResourceProvider&, const std::string&, const std::string&);
+        using PathFunction = std::string(*)(const th::Any&, const std::string&);
+        //loads a resident resource again and swaps it in, without the caller knowing its type
+        using ReloadFunction = void(*)(const ResourceProvider&, const SourceEntry&, const std::string&);
 
         struct SourceEntry
         {
             th::Any source;
-            th::Any loadingFunction;
             ListingFunction listingFunction;
             WaitFunction waitFunction;
+            //null for sources that don't declare dependencies
+            DependencyFunction dependencyFunction;
+            FetchFunction fetchFunction;
+            ReloadFunction reloadFunction;
+            //null for sources that don't name the files of their resources
+            PathFunction pathFunction;
             std::type_index typeProvided;
+            std::shared_ptr<ResourceStorage> storage;
+        };
+
+        //a resource that has to be loaded, and the ones that have to wait for it
+        struct DependencyNode
+        {
+            const SourceEntry* sourceEntry;
+            Dependency dependency;
+            size_t dependencyCount;
+            std::vector<size_t> dependents;
+        };
+
+#ifndef REX_DISABLE_ASYNC
+        struct DependencyGraph
+        {
+            std::vector<DependencyNode> nodes;
+            std::unique_ptr<std::atomic<size_t>[]> remaining;
+            std::mutex mutex;
+            std::exception_ptr error;
+            //loads the resource that was asked for once everything it needs is in, or fails it with the error of a dependency
+            std::function<void(std::exception_ptr)> finish;
+            //the load of the resource that was asked for. once a waiter claimed it, the dependencies still queued have nothing left to do
+            std::shared_ptr<QueuedLoad> load;
+            int32_t priority;
+        };
+#endif
+
+#ifndef REX_DISABLE_ASYNC
+        //a load waiting in the pool. it can be queued again with another priority, and whichever copy comes first does the load
+        struct QueuedLoad
+        {
+            QueuedLoad(Task run);
+            std::atomic<bool> claimed;
+            Task run;
+        };
+
+        //the resources behind the files that are watched. it is kept apart from the provider so that moving the provider only has to point it elsewhere
+        struct FileWatch
+        {
+            std::mutex mutex;
+            const ResourceProvider* provider;
+            std::unordered_set<std::string> sources;
+            //source and resource ids by path, since several resources may be loaded from one file
+            std::unordered_map<std::string, std::vector<std::pair<std::string, std::string>>> files;
+            //declared last, so that its thread is stopped before the rest goes away
+            std::unique_ptr<FileWatcher> watcher;
         };
+#endif
 
         public:
-            ResourceProvider(int32_t workerCount = 10);
+            //the workers load resources, and decode the ones of sources that are loaded in stages. the files of those are read separately, by as many reader threads as given, or with up to readDepth reads in flight where io_uring is used
+            ResourceProvider(int32_t workerCount = 10, int32_t readerCount = 4, int32_t readDepth = 256);
 #ifndef REX_DISABLE_ASYNC
             ResourceProvider(const ResourceProvider& other) = delete;
             ResourceProvider& operator=(const ResourceProvider& other) = delete;
@@ -51,51 +238,291 @@ namespace rex
             template <typename SourceType>
             SourceView<SourceType> addSource(const std::string& sourceId, SourceType source);
             std::vector<std::string> sources() const;
+            //both finish the loads and reloads of the sources they remove first, since those refer to them
             bool removeSource(const std::string& sourceId);
             void clearSources();
             //list
             std::vector<std::string> list(const std::string& sourceId) const;
-            //sync get
+            //sync get. the reference is not a pin: it stays valid until the resource is marked as unused, reloaded or, once a memory budget is set, until another load evicts it. hold a handle or a view for as long as the resource is needed
             template <typename ResourceType>
             const ResourceType& get(const std::string& sourceId, const std::string& resourceId) const;
             template <typename ResourceType>
             std::vector<ResourceView<ResourceType>> get(const std::string& sourceId, const std::vector<std::string>& resourceIds) const;
             template <typename ResourceType>
             std::vector<ResourceView<ResourceType>> getAll(const std::string& sourceId) const;
+            //handles
+            template <typename ResourceType>
+            ResourceHandle<ResourceType> handle(const std::string& sourceId, const std::string& resourceId) const;
+            template <typename ResourceType>
+            const ResourceType& get(const ResourceHandle<ResourceType>& handle) const;
 #ifndef REX_DISABLE_ASYNC
-            //async get
+            //async get. like in the ThreadPool, loads with lower priority values are started first
+            template <typename ResourceType>
+            AsyncResourceView<ResourceType> asyncGet(const std::string& sourceId, const std::string& resourceId, int32_t priority = 0) const;
             template <typename ResourceType>
-            AsyncResourceView<ResourceType> asyncGet(const std::string& sourceId, const std::string& resourceId) const;
+            std::vector<AsyncResourceView<ResourceType>> asyncGet(const std::string& sourceId, const std::vector<std::string>& resourceIds, int32_t priority = 0) const;
             template <typename ResourceType>
-            std::vector<AsyncResourceView<ResourceType>> asyncGet(const std::string& sourceId, const std::vector<std::string>& resourceIds) const;
+            std::vector<AsyncResourceView<ResourceType>> asyncGetAll(const std::string& sourceId, int32_t priority = 0) const;
+            //gives a load that is still waiting in the pool another priority. false if the resource is not waiting to be loaded
+            bool prioritize(const std::string& sourceId, const std::string& resourceId, int32_t priority) const;
+            //the latest lower detail version of a resource that is still being loaded by a source with progressive loading, or null if there is none
             template <typename ResourceType>
-            std::vector<AsyncResourceView<ResourceType>> asyncGetAll(const std::string& sourceId) const;
+            std::shared_ptr<const ResourceType> partial(const std::string& sourceId, const std::string& resourceId) const;
+            //loads a resident resource again on the pool and swaps the new version in once it is done. readers keep getting the old version until then without ever waiting. the old version is freed right away unless handles or views pin the resource, in which case the last of them frees it, and it counts against the budget until then. a failed reload leaves the old version in place and hands the error to the future. resources that are not loaded are left alone, since they read the new file whenever they are loaded
+            std::future<void> reload(const std::string& sourceId, const std::string& resourceId, int32_t priority = 0) const;
+            //watches the files of a source that names them with 'std::string filePath(const std::string& id) const', like FileSource, and reloads the resources whose files change. uses inotify on linux
+            void watchFiles(const std::string& sourceId);
 #endif
             //free
             void markUnused(const std::string& sourceId, const std::string& resourceId);
             void markAllUnused(const std::string& sourceId);
+            //memory budget. 0 means unlimited. any load may then evict resources that no handle or view refers to, which leaves references from get dangling
+            void setMemoryBudget(size_t bytes);
+            void setMemoryBudget(const std::string& sourceId, size_t bytes);
+            size_t memoryUsage() const;
+            size_t memoryUsage(const std::string& sourceId) const;
         private:
-            bool resourceReady(const std::string& sourceId, const std::string& resourceId) const;
-            bool resourceLoadInProgress(const std::string& sourceId, const std::string& resourceId) const;
             template <typename ResourceType>
-            const ResourceType& loadResource(const std::string& sourceId, const std::string& resourceId) const;
+            const ResourceType& loadResource(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored) const;
+            template <typename ResourceType>
+            const ResourceType& publishResource(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, ResourceType&& resource) const;
+#ifndef REX_DISABLE_ASYNC
+            template <typename ResourceType>
+            static std::shared_future<const ResourceType&>& asyncProcess(StoredResource& stored);
+            template <typename ResourceType>
+            static void setAsyncProcess(StoredResource& stored, std::shared_future<const ResourceType&> future);
+            //the state of loads comes from TaskMemory, so that starting a load doesn't allocate once warmed up
+            template <typename ResourceType>
+            static std::shared_ptr<std::promise<const ResourceType&>> makePromise();
+            static std::shared_ptr<QueuedLoad> makeQueuedLoad(Task run);
+            void enqueueLoad(std::shared_ptr<QueuedLoad> load, int32_t priority) const;
+            static void runLoad(QueuedLoad& load);
+            //a load that still waits in the pool is run right here, since it can't need anything further down the stack of this thread. otherwise this waits for whichever worker has it, and looks again now and then, since the load may only become claimable once its file is read
+            template <typename Future>
+            void waitForLoad(ResourceShard& shard, StoredResource& stored, const Future& future) const;
+            //loads the resource into the promise of a load in flight, or fails it with the given error, and then tells those listening for it
+            template <typename ResourceType>
+            void completeLoad(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, std::promise<const ResourceType&>& promise, std::exception_ptr error, FileRead* read = nullptr) const;
+            //the first stage of a load, for sources that are loaded in stages. the file is read by the read engine and then decoded on the pool. gives false for ids without a file, which are loaded the usual way to fail them with the error of the source
+            template <typename ResourceType>
+            bool queueRead(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, std::shared_ptr<std::promise<const ResourceType&>> promise, int32_t priority, std::vector<ReadEngine::Request>& reads) const;
+            //the second stage of a load, for sources that are loaded in stages
+            template <typename ResourceType>
+            const ResourceType& decodeResource(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, FileRead& read) const;
+            template <typename ResourceType>
+            void reloadResource(const SourceEntry& sourceEntry, const std::string& resourceId) const;
+            static void releaseReplaced(StoredResource& stored);
+            //flagged like markUnused, so that the last handle frees the replaced versions if there still are handles
+            static void markReplacedUnused(StoredResource& stored);
+            static void finishReload(ResourceStorage& storage);
+            //waits for the reloads of a source that is about to be removed
+            static void drainReloads(ResourceStorage& storage);
+            static void fileChanged(FileWatch& fileWatch, const std::string& path);
+            //the watcher looks up sources from its own thread, so the sources are only changed under this while files are watched
+            std::unique_lock<std::mutex> lockFileWatch() const;
+            template <typename ResourceType>
+            static AsyncResourceView<ResourceType> readyView(const std::string& resourceId, const ResourceType& resource, const ResourceHandle<ResourceType>& pinned);
+#endif
+            StoredResource& intern(ResourceShard& shard, ResourceStorage& storage, const std::string& sourceId, const std::string& resourceId) const;
+            template <typename ResourceType>
+            static ResourceHandle<ResourceType> pin(StoredResource& stored);
+            static bool resident(const SourceEntry& sourceEntry, const std::string& resourceId);
+            //the dependencies of a resource that are not loaded yet, each after its own dependencies, and with the resource itself last
+            std::vector<DependencyNode> missingDependencies(const SourceEntry& sourceEntry, const std::string& sourceId, const std::string& resourceId) const;
+            size_t visitDependency(const SourceEntry& sourceEntry, const Dependency& dependency, std::vector<DependencyNode>& nodes, std::unordered_map<std::string, size_t>& visited, std::vector<std::string>& path) const;
+            void loadDependencies(const SourceEntry& sourceEntry, const std::string& sourceId, const std::string& resourceId) const;
+#ifndef REX_DISABLE_ASYNC
+            void startDependencies(std::shared_ptr<DependencyGraph> graph) const;
+            void runDependency(std::shared_ptr<DependencyGraph> graph, size_t index) const;
+#endif
+            static size_t unload(StoredResource& stored);
+            //unloads everything in the storage with a single arena release, or does nothing and gives false if any resource is in use
+            static bool releaseAll(ResourceStorage& storage);
+            //takes the usage of a source that is being removed out of the shared budget. whatever handles still keep loaded is freed with the storage
+            static void detach(ResourceStorage& storage);
+            static void markUnused(StoredResource& stored);
+            static void releaseUnused(ResourceEntry& entry);
+            void enforceBudgets(const SourceEntry* sourceEntry, const StoredResource* keep) const;
+            size_t evict(const SourceEntry& sourceEntry, size_t bytes, const StoredResource* keep) const;
             void waitForSourceAsync(const std::string& sourceId) const;
             const SourceEntry& toSourceEntry(const std::string& sourceId) const;
 
             std::unordered_map<std::string, SourceEntry> mSources;
-            mutable std::unordered_map<std::string, std::unordered_map<std::string, th::Any>> mResources;
+            std::shared_ptr<MemoryBudget> mMemory;
 #ifndef REX_DISABLE_ASYNC
-            mutable std::unordered_map<std::string, std::unordered_map<std::string, th::Any>> mAsyncProcesses;
-            mutable std::shared_ptr<std::recursive_mutex> mResourceMutex;
             mutable std::shared_ptr<ThreadPool> mThreadPool;
+            //declared after the pool, so that it is stopped first, since finished reads are handed to the pool
+            std::shared_ptr<ReadEngine> mReadEngine;
+            //only made once files are watched. it is stopped first, since changes are handed to the pool
+            std::unique_ptr<FileWatch> mFileWatch;
 #endif
     };
 
-    inline ResourceProvider::ResourceProvider(int32_t workerCount)
+    inline ResourceProvider::StoredResource::StoredResource(const std::string& sourceId, const std::string& resourceId, ResourceStorage& storage):
+        ResourceEntry(sourceId, resourceId, &ResourceProvider::releaseUnused),
+        storage(storage),
+        value(nullptr),
+        size(0)
+#ifndef REX_DISABLE_ASYNC
+        ,
+        loading(false)
+#endif
+    {
+    }
+
+    inline ResourceProvider::ResourceStorage::ResourceStorage(std::shared_ptr<MemoryBudget> memory):
+        usage(0),
+        budget(0),
+        clockHand(0),
+        memory(std::move(memory)),
+        releasesInBulk(false),
+        detached(false)
+#ifndef REX_DISABLE_ASYNC
+        ,
+        reloads(0)
+#endif
+    {
+    }
+
+    inline ResourceProvider::ResourceStorage::~ResourceStorage()
+    {
+    }
+
+    template <typename ResourceType>
+    ResourceProvider::TypedStore<ResourceType>::TypedStore(std::shared_ptr<MemoryBudget> memory, LoadingFunction loadingFunction, DecodeFunction decodeFunction, SizeFunction sizeFunction, size_t arenaChunk):
+        ResourceStorage(std::move(memory)),
+        loadingFunction(loadingFunction),
+        decodeFunction(decodeFunction),
+        sizeFunction(sizeFunction),
+        arena(arenaChunk != 0 ? arenaChunk : DefaultChunkBytes / sizeof(ResourceType))
+    {
+        releasesInBulk = arenaChunk != 0;
+    }
+
+    template <typename ResourceType>
+    ResourceProvider::TypedStore<ResourceType>::~TypedStore()
+    {
+        //the entries are cleared here while the types are still known, the base would otherwise destroy them without releasing what they hold
+        for(auto& shard : shards)
+        {
+            for(auto& resourceIter : shard.resources)
+            {
+                if(resourceIter.second.value)
+                    destroyValue(resourceIter.second);
+#ifndef REX_DISABLE_ASYNC
+                clearAsyncProcess(resourceIter.second);
+                destroyReplaced(resourceIter.second);
+#endif
+            }
+
+            shard.resources.clear();
+        }
+    }
+
+    template <typename ResourceType>
+    ResourceType* ResourceProvider::TypedStore<ResourceType>::emplace(ResourceType&& resource)
+    {
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<std::mutex> lock(arenaMutex);
+#endif
+        return arena.create(std::move(resource));
+    }
+
+    template <typename ResourceType>
+    void ResourceProvider::TypedStore<ResourceType>::destroyValue(StoredResource& stored)
+    {
+        ResourceType* resource = static_cast<ResourceType*>(stored.value);
+        stored.value = nullptr;
+
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<std::mutex> lock(arenaMutex);
+#endif
+        arena.destroy(resource);
+    }
+
+    template <typename ResourceType>
+    void ResourceProvider::TypedStore<ResourceType>::destroyAllValues()
+    {
+        for(auto& shard : shards)
+        {
+            for(auto& resourceIter : shard.resources)
+            {
+                StoredResource& stored = resourceIter.second;
+
+                if(stored.value && !std::is_trivially_destructible<ResourceType>::value)
+                    static_cast<ResourceType*>(stored.value)->~ResourceType();
+
+                stored.value = nullptr;
+#ifndef REX_DISABLE_ASYNC
+                for(auto& replaced : stored.replaced)
+                {
+                    if(!std::is_trivially_destructible<ResourceType>::value)
+                        static_cast<ResourceType*>(replaced.first)->~ResourceType();
+                }
+
+                stored.replaced.clear();
+                stored.replacedPending.store(false, std::memory_order_relaxed);
+#endif
+            }
+        }
+
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<std::mutex> lock(arenaMutex);
+#endif
+        arena.clear();
+    }
+
+#ifndef REX_DISABLE_ASYNC
+    template <typename ResourceType>
+    void ResourceProvider::TypedStore<ResourceType>::clearAsyncProcess(StoredResource& stored)
+    {
+        stored.queued.reset();
+
+        if(!stored.loading)
+            return;
+
+        using Future = std::shared_future<const ResourceType&>;
+        asyncProcess<ResourceType>(stored).~Future();
+        stored.loading = false;
+    }
+
+    template <typename ResourceType>
+    void ResourceProvider::TypedStore<ResourceType>::destroyReplaced(StoredResource& stored)
+    {
+        if(stored.replaced.empty())
+            return;
+
+        std::lock_guard<std::mutex> lock(arenaMutex);
+
+        for(auto& replaced : stored.replaced)
+            arena.destroy(static_cast<ResourceType*>(replaced.first));
+
+        stored.replaced.clear();
+    }
+#endif
+
+    inline ResourceProvider::MemoryBudget::MemoryBudget():
+        usage(0),
+        budget(0)
+    {
+    }
+
+    inline size_t ResourceProvider::ResourceStorage::shardIndex(const std::string& resourceId)
+    {
+        return std::hash<std::string>()(resourceId) % ShardCount;
+    }
+
+    inline ResourceProvider::ResourceShard& ResourceProvider::ResourceStorage::shard(const std::string& resourceId)
+    {
+        return shards[shardIndex(resourceId)];
+    }
+
+    inline ResourceProvider::ResourceProvider(int32_t workerCount, int32_t readerCount, int32_t readDepth):
+         mMemory(std::make_shared<MemoryBudget>())
 #ifndef REX_DISABLE_ASYNC
-        :
-         mResourceMutex(std::make_shared<std::recursive_mutex>()),
-         mThreadPool(std::make_shared<ThreadPool>(workerCount))
+        ,
+         mThreadPool(std::make_shared<ThreadPool>(workerCount)),
+         mReadEngine(std::make_shared<ReadEngine>(readerCount, readDepth))
 #endif
     {
     }
@@ -103,20 +530,38 @@ namespace rex
 #ifndef REX_DISABLE_ASYNC
     inline ResourceProvider::ResourceProvider(ResourceProvider&& other)
     {
+        //held throughout, so that the watcher never reloads from a provider that is half moved
+        std::unique_lock<std::mutex> lock = other.lockFileWatch();
+
         mSources = std::move(other.mSources);
-        mResources = std::move(other.mResources);
-        mAsyncProcesses = std::move(other.mAsyncProcesses);
-        mResourceMutex = std::move(other.mResourceMutex);
-        mThreadPool = std::move(mThreadPool);
+        mMemory = std::move(other.mMemory);
+        mThreadPool = std::move(other.mThreadPool);
+        mReadEngine = std::move(other.mReadEngine);
+        mFileWatch = std::move(other.mFileWatch);
+
+        if(mFileWatch)
+            mFileWatch->provider = this;
     }
 
     inline ResourceProvider& ResourceProvider::operator=(ResourceProvider&& other)
     {
+        if(this == &other)
+            return *this;
+
+        //the own watcher is stopped first, since it reloads from the sources that are about to go
+        mFileWatch.reset();
+        clearSources();
+
+        std::unique_lock<std::mutex> lock = other.lockFileWatch();
+
         mSources = std::move(other.mSources);
-        mResources = std::move(other.mResources);
-        mAsyncProcesses = std::move(other.mAsyncProcesses);
-        mResourceMutex = std::move(other.mResourceMutex);
-        mThreadPool = std::move(mThreadPool);
+        mMemory = std::move(other.mMemory);
+        mThreadPool = std::move(other.mThreadPool);
+        mReadEngine = std::move(other.mReadEngine);
+        mFileWatch = std::move(other.mFileWatch);
+
+        if(mFileWatch)
+            mFileWatch->provider = this;
 
         return *this;
     }
@@ -145,9 +590,23 @@ namespace rex
     SourceView<SourceType> ResourceProvider::addSource(const std::string& sourceId, SourceType source)
     {
         using ResourceType = decltype(source.load(std::string()));
-        LoadingFunction<ResourceType> loadingFunction = [] (const th::Any& packedSource, const std::string& identifier)
+#ifndef REX_DISABLE_ASYNC
+        static_assert(sizeof(std::shared_future<const ResourceType&>) == sizeof(std::shared_future<const char&>) && alignof(std::shared_future<const ResourceType&>) == alignof(std::shared_future<const char&>), "in flight loads are kept in place, which needs all shared_future types to have the same layout");
+#endif
+
+        typename TypedStore<ResourceType>::LoadingFunction loadingFunction = [] (const th::Any& packedSource, StoredResource& stored)
         {
-            return packedSource.get<SourceType>().load(identifier);
+            if(!HasProgressiveLoad<SourceType, ResourceType>::value)
+                return packedSource.get<SourceType>().load(stored.resourceId);
+
+            std::function<void(ResourceType)> publish = [&stored] (ResourceType partial)
+            {
+#ifndef REX_DISABLE_ASYNC
+                std::atomic_store(&stored.partial, std::shared_ptr<const void>(std::make_shared<const ResourceType>(std::move(partial))));
+#endif
+            };
+
+            return loadProgressively(packedSource.get<SourceType>(), stored.resourceId, publish);
         };
 
         ListingFunction listingFunction = [] (const th::Any& packedSource)
@@ -155,18 +614,83 @@ namespace rex
             return packedSource.get<SourceType>().list();
         };
 
-        WaitFunction waitFunction = [] (const th::Any& packedFuture)
+        WaitFunction waitFunction = [] (const ResourceProvider& provider, ResourceShard& shard, const std::string& resourceId)
+        {
+#ifndef REX_DISABLE_ASYNC
+            std::shared_future<const ResourceType&> future;
+            StoredResource* stored = nullptr;
+
+            {
+                std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+                auto resourceIter = shard.resources.find(resourceId);
+
+                if(resourceIter != shard.resources.end() && resourceIter->second.loading)
+                {
+                    future = asyncProcess<ResourceType>(resourceIter->second);
+                    stored = &resourceIter->second;
+                }
+            }
+
+            //the load finishes by taking the lock, so the wait must happen without it
+            if(future.valid())
+                provider.waitForLoad(shard, *stored, future);
+#endif
+        };
+
+        typename TypedStore<ResourceType>::SizeFunction sizeFunction = [] (const th::Any& packedSource, const ResourceType& resource)
+        {
+            return estimateSize(packedSource.get<SourceType>(), resource);
+        };
+
+        DependencyFunction dependencyFunction = nullptr;
+
+        if(HasDependencies<SourceType>::value)
+        {
+            dependencyFunction = [] (const th::Any& packedSource, const std::string& identifier)
+            {
+                return dependencies(packedSource.get<SourceType>(), identifier);
+            };
+        }
+
+        FetchFunction fetchFunction = [] (const ResourceProvider& provider, const std::string& sourceId, const std::string& identifier)
+        {
+            provider.get<ResourceType>(sourceId, identifier);
+        };
+
+        ReloadFunction reloadFunction = [] (const ResourceProvider& provider, const SourceEntry& sourceEntry, const std::string& identifier)
         {
 #ifndef REX_DISABLE_ASYNC
-            packedFuture.get<std::shared_future<const ResourceType&>>().wait();
+            provider.reloadResource<ResourceType>(sourceEntry, identifier);
 #endif
         };
 
-        auto added = mSources.emplace(sourceId, SourceEntry{std::move(source), loadingFunction, listingFunction, waitFunction, typeid(ResourceType)});
-        mResources[sourceId];
+        PathFunction pathFunction = nullptr;
+
+        if(HasFilePath<SourceType>::value)
+        {
+            pathFunction = [] (const th::Any& packedSource, const std::string& identifier)
+            {
+                return filePath(packedSource.get<SourceType>(), identifier);
+            };
+        }
+
+        typename TypedStore<ResourceType>::DecodeFunction decodeFunction = nullptr;
+
+        //a progressive load publishes while it reads, so it is left to the source
+        if(HasFileStages<SourceType, ResourceType>::value && !HasProgressiveLoad<SourceType, ResourceType>::value)
+        {
+            decodeFunction = [] (const th::Any& packedSource, const std::string& identifier, const char* data, size_t size)
+            {
+                return decode<SourceType, ResourceType>(packedSource.get<SourceType>(), identifier, data, size);
+            };
+        }
+
+        size_t arenaChunk = ArenaChunk<SourceType>::value;
+
 #ifndef REX_DISABLE_ASYNC
-        mAsyncProcesses[sourceId];
+        std::unique_lock<std::mutex> lock = lockFileWatch();
 #endif
+        auto added = mSources.emplace(sourceId, SourceEntry{std::move(source), listingFunction, waitFunction, dependencyFunction, fetchFunction, reloadFunction, pathFunction, typeid(ResourceType), std::make_shared<TypedStore<ResourceType>>(mMemory, loadingFunction, decodeFunction, sizeFunction, arenaChunk)});
 
         if(added.second)
             return SourceView<SourceType>
@@ -190,21 +714,58 @@ namespace rex
 
     inline bool ResourceProvider::removeSource(const std::string& sourceId)
     {
-        mResources.erase(sourceId);
+        auto sourceIterator = mSources.find(sourceId);
+
+        if(sourceIterator == mSources.end())
+            return false;
+
 #ifndef REX_DISABLE_ASYNC
-        mAsyncProcesses.erase(sourceId);
+        std::unique_lock<std::mutex> lock = lockFileWatch();
+
+        if(mFileWatch && mFileWatch->sources.erase(sourceId) != 0)
+        {
+            for(auto& file : mFileWatch->files)
+            {
+                auto& resources = file.second;
+                resources.erase(std::remove_if(resources.begin(), resources.end(), [&sourceId] (const std::pair<std::string, std::string>& resource)
+                {
+                    return resource.first == sourceId;
+                }), resources.end());
+            }
+        }
+
+        //the watcher can't queue any more of them while its lock is held. loads that are still queued are run right here, so that nothing is left referring to the source
+        drainReloads(*sourceIterator->second.storage);
+        waitForSourceAsync(sourceId);
 #endif
 
-        return mSources.erase(sourceId) != 0;
+        detach(*sourceIterator->second.storage);
+        mSources.erase(sourceIterator);
+        return true;
     }
 
     inline void ResourceProvider::clearSources()
     {
-        mSources.clear();
-        mResources.clear();
 #ifndef REX_DISABLE_ASYNC
-        mAsyncProcesses.clear();
+        std::unique_lock<std::mutex> lock = lockFileWatch();
+
+        if(mFileWatch)
+        {
+            mFileWatch->sources.clear();
+            mFileWatch->files.clear();
+        }
+#endif
+
+        for(const auto& source : mSources)
+        {
+#ifndef REX_DISABLE_ASYNC
+            drainReloads(*source.second.storage);
+            waitForSourceAsync(source.first);
 #endif
+            detach(*source.second.storage);
+        }
+
+        mSources.clear();
     }
 
     inline std::vector<std::string> ResourceProvider::list(const std::string& sourceId) const
@@ -219,40 +780,99 @@ namespace rex
     {
         const auto& sourceEntry = toSourceEntry(sourceId);
 
-        const auto& source = sourceEntry.source;
-
         if(std::type_index(typeid(ResourceType)) != sourceEntry.typeProvided)
             throw InvalidSourceException("trying to access source id " + sourceId + " as the wrong type");
 
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
+
 #ifndef REX_DISABLE_ASYNC
+        {//resident resources are found under a shared lock only, so concurrent readers never wait on each other
+            SharedLock lock(shard.tableMutex);
+            auto resourceIter = shard.resources.find(resourceId);
+
+            if(resourceIter != shard.resources.end())
+            {
+                const void* resource = resourceIter->second.resource.load(std::memory_order_acquire);
+
+                if(resource)
+                {
+                    resourceIter->second.touch();
+                    return *static_cast<const ResourceType*>(resource);
+                }
+            }
+        }
+
+        //loaded before the load lock is taken, since they may live in other shards
+        if(sourceEntry.dependencyFunction)
+            loadDependencies(sourceEntry, sourceId, resourceId);
+
         std::shared_future<const ResourceType&> futureToWaitFor;
+        StoredResource* waitingOn = nullptr;
 
         {
-            std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
+            std::unique_lock<std::recursive_mutex> lock(shard.loadMutex);
+            StoredResource& stored = intern(shard, *sourceEntry.storage, sourceId, resourceId);
 
-            //there are three possible cases, and with the lock on, these won't change
+            //there are three possible cases, and with the load lock on, these won't change
             
-            //1. it is already loaded, so just return it
-            if(mResources.at(sourceId).count(resourceId) != 0)
-                return mResources.at(sourceId).at(resourceId).get<ResourceType>();
+            //1. it got loaded since we looked, so just return it
+            if(stored.value)
+            {
+                stored.touch();
+                return *static_cast<const ResourceType*>(stored.value);
+            }
 
-            //2. it is not loaded and no process is loading it
-            if(mAsyncProcesses.at(sourceId).count(resourceId) == 0)
-                return loadResource<ResourceType>(sourceId, resourceId);
+            //2. it is not loaded and no process is loading it. it is registered as in flight and loaded on this thread without the lock, so that a slow load doesn't hold up the rest of the shard
+            if(!stored.loading)
+            {
+                std::promise<const ResourceType&> promise;
+                futureToWaitFor = promise.get_future();
+                setAsyncProcess<ResourceType>(stored, futureToWaitFor);
+                lock.unlock();
+
+                try
+                {
+                    const ResourceType& resource = loadResource<ResourceType>(sourceEntry, shard, stored);
+                    promise.set_value(resource);
+                    stored.notifyListeners(false);
+
+                    return resource;
+                }
+                catch(...)
+                {
+                    {//unlike a failed async load, a failed sync load is tried again by the next get
+                        std::lock_guard<std::recursive_mutex> relock(shard.loadMutex);
+                        stored.storage.clearAsyncProcess(stored);
+                    }
+
+                    promise.set_exception(std::current_exception());
+                    stored.notifyListeners(true);
+                    throw;
+                }
+            }
 
             //3. it is not loaded and there is a process that loads it already
-            futureToWaitFor = mAsyncProcesses.at(sourceId).at(resourceId).get<std::shared_future<const ResourceType&>>();
+            futureToWaitFor = asyncProcess<ResourceType>(stored);
+            waitingOn = &stored;
         }
 
-        futureToWaitFor.wait();
+        waitForLoad(shard, *waitingOn, futureToWaitFor);
 
         return futureToWaitFor.get();
 #else
+        if(sourceEntry.dependencyFunction)
+            loadDependencies(sourceEntry, sourceId, resourceId);
+
         //Without async, it is either loaded or not, so just return it or load-return it
-        if(mResources.at(sourceId).count(resourceId) != 0)
-            return mResources.at(sourceId).at(resourceId).get<ResourceType>();
+        StoredResource& stored = intern(shard, *sourceEntry.storage, sourceId, resourceId);
+
+        if(stored.value)
+        {
+            stored.touch();
+            return *static_cast<const ResourceType*>(stored.value);
+        }
 		else
-			return loadResource<ResourceType>(sourceId, resourceId);
+			return loadResource<ResourceType>(sourceEntry, shard, stored);
 #endif
     }
 
@@ -262,7 +882,10 @@ namespace rex
         std::vector<ResourceView<ResourceType>> result;
 
         for(const std::string& resourceId : resourceIds)
-            result.emplace_back(ResourceView<ResourceType>{resourceId, get<ResourceType>(sourceId, resourceId)});
+        {//pinned before it is loaded so that it can't be evicted before the view holds it
+            ResourceHandle<ResourceType> pinned = handle<ResourceType>(sourceId, resourceId);
+            result.emplace_back(ResourceView<ResourceType>{resourceId, get(pinned), pinned});
+        }
 
         return result;
     }
@@ -277,93 +900,400 @@ namespace rex
         return get<ResourceType>(sourceId, idList);
     }
 
-#ifndef REX_DISABLE_ASYNC
     template <typename ResourceType>
-    AsyncResourceView<ResourceType> ResourceProvider::asyncGet(const std::string& sourceId, const std::string& resourceId) const
+    ResourceHandle<ResourceType> ResourceProvider::handle(const std::string& sourceId, const std::string& resourceId) const
     {
         const auto& sourceEntry = toSourceEntry(sourceId);
 
         if(std::type_index(typeid(ResourceType)) != sourceEntry.typeProvided)
             throw InvalidSourceException("trying to access source id " + sourceId + " as the wrong type");
 
-        bool resourceIsReady = false;
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
 
-        {
-            std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
-            resourceIsReady = resourceReady(sourceId, resourceId);
-        }
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+#endif
 
-        if(resourceIsReady)
-        {//the resource is ready and this won't change from another thread
-            std::promise<const ResourceType&> promise;
-            std::shared_future<const ResourceType&> future = promise.get_future();
-            promise.set_value(mResources.at(sourceId).at(resourceId).get<ResourceType>());
-            return {resourceId, future};
-        }
-        else
-        {
-            {
-                std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
+        return pin<ResourceType>(intern(shard, *sourceEntry.storage, sourceId, resourceId));
+    }
 
-                if(resourceLoadInProgress(sourceId, resourceId))
-                {//there is a future ready to piggyback on
-                    return AsyncResourceView<ResourceType>{resourceId, mAsyncProcesses.at(sourceId).at(resourceId).get<std::shared_future<const ResourceType&>>()};
-                }
-            }
+    template <typename ResourceType>
+    const ResourceType& ResourceProvider::get(const ResourceHandle<ResourceType>& handle) const
+    {
+        if(!handle.mEntry)
+            throw InvalidResourceException("trying to access a resource through an empty handle");
 
-            //if we reached here, it means that there is no currently loaded resource and no process to load it, and this won't change, so it is safe to start loading
-            {//other threads can still affect the storage on other resources though so we better lock
-                std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
+        const void* resource = handle.mEntry->resource.load(std::memory_order_acquire);
 
-                auto boundLaunch = std::bind(&ResourceProvider::loadResource<ResourceType>, this, sourceId, resourceId);
-                std::shared_future<const ResourceType&> futureResource = mThreadPool->enqueue(std::move(boundLaunch), 0);
+        if(resource)
+        {
+            handle.mEntry->touch();
+            return *static_cast<const ResourceType*>(resource);
+        }
 
-                auto emplaced = mAsyncProcesses.at(sourceId).emplace(resourceId, std::move(futureResource));
-                return AsyncResourceView<ResourceType>{resourceId, emplaced.first->second.template get<std::shared_future<const ResourceType&>>()};
+        return get<ResourceType>(handle.mEntry->sourceId, handle.mEntry->resourceId);
+    }
+
+#ifndef REX_DISABLE_ASYNC
+    template <typename ResourceType>
+    AsyncResourceView<ResourceType> ResourceProvider::asyncGet(const std::string& sourceId, const std::string& resourceId, int32_t priority) const
+    {
+        const auto& sourceEntry = toSourceEntry(sourceId);
+
+        if(std::type_index(typeid(ResourceType)) != sourceEntry.typeProvided)
+            throw InvalidSourceException("trying to access source id " + sourceId + " as the wrong type");
+
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
+        //declared outside of the table lock since letting go of a handle may need the load lock
+        ResourceHandle<ResourceType> pinned;
+
+        {//the resource is ready and the pin keeps it that way
+            SharedLock lock(shard.tableMutex);
+            auto resourceIter = shard.resources.find(resourceId);
+
+            if(resourceIter != shard.resources.end())
+            {
+                pinned = pin<ResourceType>(resourceIter->second);
+                const void* resource = resourceIter->second.resource.load(std::memory_order_acquire);
+
+                if(resource)
+                {
+                    resourceIter->second.touch();
+                    return readyView(resourceId, *static_cast<const ResourceType*>(resource), pinned);
+                }
+            }
+        }
+
+        //worked out before the load lock is taken since that may need other shards. a graph of just the resource itself means that nothing has to wait
+        std::shared_ptr<DependencyGraph> graph;
+
+        if(sourceEntry.dependencyFunction)
+        {
+            std::vector<DependencyNode> nodes = missingDependencies(sourceEntry, sourceId, resourceId);
+
+            if(nodes.size() > 1)
+            {
+                graph = std::make_shared<DependencyGraph>();
+                graph->nodes = std::move(nodes);
+                graph->priority = priority;
             }
         }
+
+        std::unique_lock<std::recursive_mutex> lock(shard.loadMutex);
+        StoredResource& stored = intern(shard, *sourceEntry.storage, sourceId, resourceId);
+        pinned = pin<ResourceType>(stored);
+
+        if(stored.value)
+        {
+            stored.touch();
+            return readyView(resourceId, *static_cast<const ResourceType*>(stored.value), pinned);
+        }
+
+        if(stored.loading)
+        {//there is a future ready to piggyback on
+            return AsyncResourceView<ResourceType>{resourceId, asyncProcess<ResourceType>(stored), pinned};
+        }
+
+        //if we reached here, it means that there is no currently loaded resource and no process to load it, and this won't change while we hold the load lock, so it is safe to start loading
+        if(graph)
+        {//the load is registered as in flight right away and started by whichever dependency finishes last, so no worker ever sits waiting for another
+            auto promise = makePromise<ResourceType>();
+            std::shared_future<const ResourceType&> futureResource = promise->get_future();
+
+            //claimed by a thread that waits for the resource, which can't count on the queued dependencies getting a worker, so it loads them itself
+            auto queued = makeQueuedLoad([this, &sourceEntry, &shard, &stored, promise] ()
+            {
+                std::exception_ptr error;
+
+                try
+                {
+                    loadDependencies(sourceEntry, stored.sourceId, stored.resourceId);
+                }
+                catch(...)
+                {
+                    error = std::current_exception();
+                }
+
+                completeLoad<ResourceType>(sourceEntry, shard, stored, *promise, error);
+            });
+
+            graph->finish = [this, &sourceEntry, &shard, &stored, promise, queued] (std::exception_ptr error)
+            {
+                if(!queued->claimed.exchange(true))
+                    completeLoad<ResourceType>(sourceEntry, shard, stored, *promise, error);
+            };
+
+            graph->load = queued;
+            stored.queued = queued;
+            setAsyncProcess<ResourceType>(stored, futureResource);
+            lock.unlock();
+
+            startDependencies(graph);
+            return AsyncResourceView<ResourceType>{resourceId, futureResource, pinned};
+        }
+
+        auto promise = makePromise<ResourceType>();
+        std::shared_future<const ResourceType&> futureResource = promise->get_future();
+        setAsyncProcess<ResourceType>(stored, futureResource);
+
+        std::vector<ReadEngine::Request> reads;
+
+        if(queueRead<ResourceType>(sourceEntry, shard, stored, promise, priority, reads))
+        {
+            lock.unlock();
+            mReadEngine->submit(std::move(reads));
+
+            return AsyncResourceView<ResourceType>{resourceId, futureResource, pinned};
+        }
+
+        auto queued = makeQueuedLoad([this, &sourceEntry, &shard, &stored, promise] ()
+        {
+            completeLoad<ResourceType>(sourceEntry, shard, stored, *promise, nullptr);
+        });
+
+        stored.queued = queued;
+        enqueueLoad(std::move(queued), priority);
+
+        return AsyncResourceView<ResourceType>{resourceId, futureResource, pinned};
     }
 
     template <typename ResourceType>
-    std::vector<AsyncResourceView<ResourceType>> ResourceProvider::asyncGet(const std::string& sourceId, const std::vector<std::string>& resourceIds) const
+    std::vector<AsyncResourceView<ResourceType>> ResourceProvider::asyncGet(const std::string& sourceId, const std::vector<std::string>& resourceIds, int32_t priority) const
     {
-        std::vector<AsyncResourceView<ResourceType>> result;
+        const auto& sourceEntry = toSourceEntry(sourceId);
 
-        for(const std::string& resourceId : resourceIds)
-            result.emplace_back(asyncGet<ResourceType>(sourceId, resourceId));
+        if(std::type_index(typeid(ResourceType)) != sourceEntry.typeProvided)
+            throw InvalidSourceException("trying to access source id " + sourceId + " as the wrong type");
+
+        std::vector<AsyncResourceView<ResourceType>> result(resourceIds.size());
+
+        //every resource gets its own graph of dependencies, so they can't share chunks
+        if(sourceEntry.dependencyFunction)
+        {
+            for(size_t i = 0; i < resourceIds.size(); ++i)
+                result[i] = asyncGet<ResourceType>(sourceId, resourceIds[i], priority);
+
+            return result;
+        }
+
+        std::vector<std::shared_ptr<QueuedLoad>> pending;
+        std::vector<ReadEngine::Request> reads;
+
+        //group the ids by shard so that each shard is locked once for the whole batch
+        std::array<std::vector<size_t>, ResourceStorage::ShardCount> byShard;
+
+        for(size_t i = 0; i < resourceIds.size(); ++i)
+            byShard[ResourceStorage::shardIndex(resourceIds[i])].push_back(i);
+
+        for(size_t shardIndex = 0; shardIndex < ResourceStorage::ShardCount; ++shardIndex)
+        {
+            if(byShard[shardIndex].empty())
+                continue;
+
+            ResourceShard& shard = sourceEntry.storage->shards[shardIndex];
+            std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+
+            for(size_t index : byShard[shardIndex])
+            {
+                const std::string& resourceId = resourceIds[index];
+                StoredResource& stored = intern(shard, *sourceEntry.storage, sourceId, resourceId);
+                ResourceHandle<ResourceType> pinned = pin<ResourceType>(stored);
+
+                if(stored.value)
+                {
+                    stored.touch();
+                    result[index] = readyView(resourceId, *static_cast<const ResourceType*>(stored.value), pinned);
+                }
+                else if(stored.loading)
+                {//piggyback, this also covers ids that are given more than once
+                    result[index] = AsyncResourceView<ResourceType>{resourceId, asyncProcess<ResourceType>(stored), pinned};
+                }
+                else
+                {//registered as in flight right away, so nothing can start a second load while the batch is queued
+                    auto promise = makePromise<ResourceType>();
+                    std::shared_future<const ResourceType&> future = promise->get_future();
+
+                    if(!queueRead<ResourceType>(sourceEntry, shard, stored, promise, priority, reads))
+                    {
+                        pending.push_back(makeQueuedLoad([this, &sourceEntry, &shard, &stored, promise] ()
+                        {
+                            completeLoad<ResourceType>(sourceEntry, shard, stored, *promise, nullptr);
+                        }));
+
+                        stored.queued = pending.back();
+                    }
+
+                    setAsyncProcess<ResourceType>(stored, future);
+                    result[index] = AsyncResourceView<ResourceType>{resourceId, std::move(future), pinned};
+                }
+            }
+        }
+
+        //submitted without any shard lock, since reads that fail right away complete on this thread
+        if(!reads.empty())
+            mReadEngine->submit(std::move(reads));
+
+        if(pending.empty())
+            return result;
+
+        //a few chunks per worker keeps the queue short while still leaving something to steal when load times differ
+        size_t chunkCount = std::min(pending.size(), std::max<size_t>(mThreadPool->threadCount(), 1) * 4);
+        size_t chunkSize = (pending.size() + chunkCount - 1) / chunkCount;
+
+        for(size_t chunkStart = 0; chunkStart < pending.size(); chunkStart += chunkSize)
+        {
+            size_t chunkEnd = std::min(chunkStart + chunkSize, pending.size());
+            auto chunk = std::make_shared<std::vector<std::shared_ptr<QueuedLoad>>>(std::make_move_iterator(pending.begin() + chunkStart), std::make_move_iterator(pending.begin() + chunkEnd));
+
+            //loads that were given another priority meanwhile are skipped here
+            mThreadPool->enqueue([chunk] ()
+            {
+                for(const auto& load : *chunk)
+                    runLoad(*load);
+            }, priority);
+        }
 
         return result;
     }
 
     template <typename ResourceType>
-    std::vector<AsyncResourceView<ResourceType>> ResourceProvider::asyncGetAll(const std::string& sourceId) const
+    std::vector<AsyncResourceView<ResourceType>> ResourceProvider::asyncGetAll(const std::string& sourceId, int32_t priority) const
     {
         const auto& sourceEntry = toSourceEntry(sourceId);
 
         std::vector<std::string> idList = sourceEntry.listingFunction(sourceEntry.source);
 
-        return asyncGet<ResourceType>(sourceId, idList);
+        return asyncGet<ResourceType>(sourceId, idList, priority);
+    }
+
+    inline bool ResourceProvider::prioritize(const std::string& sourceId, const std::string& resourceId, int32_t priority) const
+    {
+        const auto& sourceEntry = toSourceEntry(sourceId);
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
+
+        std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+        auto resourceIter = shard.resources.find(resourceId);
+
+        if(resourceIter == shard.resources.end())
+            return false;
+
+        std::shared_ptr<QueuedLoad> queued = resourceIter->second.queued;
+
+        if(!queued || queued->claimed.load())
+            return false;
+
+        //the copy already in the pool stays there and does nothing if this one comes first
+        enqueueLoad(std::move(queued), priority);
+        return true;
+    }
+
+    template <typename ResourceType>
+    std::shared_ptr<const ResourceType> ResourceProvider::partial(const std::string& sourceId, const std::string& resourceId) const
+    {
+        const auto& sourceEntry = toSourceEntry(sourceId);
+
+        if(std::type_index(typeid(ResourceType)) != sourceEntry.typeProvided)
+            throw InvalidSourceException("trying to access source id " + sourceId + " as the wrong type");
+
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
+        SharedLock lock(shard.tableMutex);
+        auto resourceIter = shard.resources.find(resourceId);
+
+        if(resourceIter == shard.resources.end())
+            return nullptr;
+
+        return std::static_pointer_cast<const ResourceType>(std::atomic_load(&resourceIter->second.partial));
+    }
+
+    inline std::future<void> ResourceProvider::reload(const std::string& sourceId, const std::string& resourceId, int32_t priority) const
+    {
+        const auto& sourceEntry = toSourceEntry(sourceId);
+        std::shared_ptr<ResourceStorage> storage = sourceEntry.storage;
+
+        {
+            std::lock_guard<std::mutex> lock(storage->reloadMutex);
+            ++storage->reloads;
+        }
+
+        return mThreadPool->enqueue([this, &sourceEntry, resourceId, storage] ()
+        {
+            try
+            {
+                sourceEntry.reloadFunction(*this, sourceEntry, resourceId);
+            }
+            catch(...)
+            {
+                finishReload(*storage);
+                throw;
+            }
+
+            finishReload(*storage);
+        }, priority);
+    }
+
+    inline void ResourceProvider::watchFiles(const std::string& sourceId)
+    {
+        const auto& sourceEntry = toSourceEntry(sourceId);
+
+        if(!sourceEntry.pathFunction)
+            throw InvalidSourceException("trying to watch the files of source id " + sourceId + " which doesn't name its files");
+
+        if(!mFileWatch)
+        {
+            mFileWatch.reset(new FileWatch());
+            mFileWatch->provider = this;
+
+            FileWatch* fileWatch = mFileWatch.get();
+            mFileWatch->watcher.reset(new FileWatcher([fileWatch] (const std::string& path)
+            {
+                fileChanged(*fileWatch, path);
+            }));
+        }
+
+        std::lock_guard<std::mutex> lock(mFileWatch->mutex);
+
+        if(!mFileWatch->sources.insert(sourceId).second)
+            return;
+
+        for(const std::string& resourceId : sourceEntry.listingFunction(sourceEntry.source))
+        {
+            std::string path;
+
+            try
+            {
+                path = sourceEntry.pathFunction(sourceEntry.source, resourceId);
+            }
+            catch(...)
+            {
+                continue;
+            }
+
+            mFileWatch->files[path].emplace_back(sourceId, resourceId);
+            mFileWatch->watcher->watch(path);
+        }
     }
 #endif
 
     inline void ResourceProvider::markUnused(const std::string& sourceId, const std::string& resourceId)
     {
         const auto& sourceEntry = toSourceEntry(sourceId);
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
 #ifndef REX_DISABLE_ASYNC
-        auto waitFunction = sourceEntry.waitFunction;
-        auto asyncIter = mAsyncProcesses.at(sourceId).find(resourceId);
+        sourceEntry.waitFunction(*this, shard, resourceId);
 
-        if(asyncIter != mAsyncProcesses.at(sourceId).end())
-            waitFunction(asyncIter->second);
+        std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+#endif
+        auto resourceIter = shard.resources.find(resourceId);
 
+        //the entry itself stays interned so that handles to it remain usable. if it is still in use, the last handle to let go of it frees it
+        if(resourceIter != shard.resources.end())
         {
-            std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
-            mResources.at(sourceId).erase(resourceId);
-            mAsyncProcesses.at(sourceId).erase(resourceId);
-        }
-#else
-        mResources.at(sourceId).erase(resourceId);
+            StoredResource& stored = resourceIter->second;
+            markUnused(stored);
+#ifndef REX_DISABLE_ASYNC
+            stored.storage.clearAsyncProcess(stored);
 #endif
+        }
     }
 
     inline void ResourceProvider::markAllUnused(const std::string& sourceId)
@@ -372,69 +1302,761 @@ namespace rex
 
 #ifndef REX_DISABLE_ASYNC
         waitForSourceAsync(sourceId);
+#endif
+
+        if(sourceEntry.storage->releasesInBulk && releaseAll(*sourceEntry.storage))
+            return;
 
+        for(auto& shard : sourceEntry.storage->shards)
         {
-            std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
-            mResources.at(sourceId).clear();
-            mAsyncProcesses.at(sourceId).clear();
-        }
-#else
-            mResources.at(sourceId).clear();
+#ifndef REX_DISABLE_ASYNC
+            std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+#endif
+            for(auto& resourceIter : shard.resources)
+            {
+                StoredResource& stored = resourceIter.second;
+                markUnused(stored);
+#ifndef REX_DISABLE_ASYNC
+                stored.storage.clearAsyncProcess(stored);
 #endif
+            }
+        }
     }
 
-    inline bool ResourceProvider::resourceReady(const std::string& sourceId, const std::string& resourceId) const
+    inline void ResourceProvider::setMemoryBudget(size_t bytes)
     {
-        auto sourceIterator = mResources.find(sourceId);
+        mMemory->budget = bytes;
+        enforceBudgets(nullptr, nullptr);
+    }
+
+    inline void ResourceProvider::setMemoryBudget(const std::string& sourceId, size_t bytes)
+    {
+        const auto& sourceEntry = toSourceEntry(sourceId);
+
+        sourceEntry.storage->budget = bytes;
+        enforceBudgets(&sourceEntry, nullptr);
+    }
 
-        if(sourceIterator != mResources.end())
-            return sourceIterator->second.count(resourceId) != 0;
+    inline size_t ResourceProvider::memoryUsage() const
+    {
+        return mMemory->usage;
+    }
 
-        return false;
+    inline size_t ResourceProvider::memoryUsage(const std::string& sourceId) const
+    {
+        return toSourceEntry(sourceId).storage->usage;
     }
 
-    inline bool ResourceProvider::resourceLoadInProgress(const std::string& sourceId, const std::string& resourceId) const
+    template <typename ResourceType>
+    const ResourceType& ResourceProvider::loadResource(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored) const
     {
+        try
+        {
+            auto& store = static_cast<TypedStore<ResourceType>&>(stored.storage);
+
+            return publishResource(sourceEntry, shard, stored, store.loadingFunction(sourceEntry.source, stored));
+        }
+        catch(const std::exception& exception)
+        {
 #ifndef REX_DISABLE_ASYNC
-        auto sourceIterator = mAsyncProcesses.find(sourceId);
+            std::atomic_store(&stored.partial, std::shared_ptr<const void>());
+#endif
+            throw InvalidResourceException(exception.what());
+        }
+    }
 
-        if(sourceIterator != mAsyncProcesses.end())
-            return sourceIterator->second.count(resourceId);
+    template <typename ResourceType>
+    const ResourceType& ResourceProvider::publishResource(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, ResourceType&& resource) const
+    {
+        auto& store = static_cast<TypedStore<ResourceType>&>(stored.storage);
 
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+#endif
+        //publishing doesn't change the table, so readers are not blocked by it
+        ResourceType* published = store.emplace(std::move(resource));
+        stored.value = published;
+        stored.referenced.store(true, std::memory_order_relaxed);
+        stored.unusedPending.store(false, std::memory_order_relaxed);
+        stored.resource.store(published, std::memory_order_release);
+#ifndef REX_DISABLE_ASYNC
+        stored.storage.clearAsyncProcess(stored);
+        std::atomic_store(&stored.partial, std::shared_ptr<const void>());
 #endif
-        return false;
+
+        stored.size = store.sizeFunction(sourceEntry.source, *published);
+        sourceEntry.storage->usage += stored.size;
+        mMemory->usage += stored.size;
+
+        enforceBudgets(&sourceEntry, &stored);
+
+        return *published;
+    }
+
+#ifndef REX_DISABLE_ASYNC
+    inline ResourceProvider::QueuedLoad::QueuedLoad(Task run):
+        claimed(false),
+        run(std::move(run))
+    {
     }
 
     template <typename ResourceType>
-    const ResourceType& ResourceProvider::loadResource(const std::string& sourceId, const std::string& resourceId) const
+    std::shared_ptr<std::promise<const ResourceType&>> ResourceProvider::makePromise()
     {
-        const auto& sourceEntry = toSourceEntry(sourceId);
+        return std::allocate_shared<std::promise<const ResourceType&>>(TaskAllocator<char>(), std::allocator_arg, TaskAllocator<char>());
+    }
+
+    inline std::shared_ptr<ResourceProvider::QueuedLoad> ResourceProvider::makeQueuedLoad(Task run)
+    {
+        return std::allocate_shared<QueuedLoad>(TaskAllocator<QueuedLoad>(), std::move(run));
+    }
+
+    inline void ResourceProvider::enqueueLoad(std::shared_ptr<QueuedLoad> load, int32_t priority) const
+    {
+        mThreadPool->enqueue([load] ()
+        {
+            runLoad(*load);
+        }, priority);
+    }
+
+    inline void ResourceProvider::runLoad(QueuedLoad& load)
+    {
+        if(!load.claimed.exchange(true))
+            load.run();
+    }
+
+    template <typename Future>
+    void ResourceProvider::waitForLoad(ResourceShard& shard, StoredResource& stored, const Future& future) const
+    {
+        while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            std::shared_ptr<QueuedLoad> queued;
+
+            {
+                std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+                queued = stored.queued;
+            }
+
+            if(queued)
+                runLoad(*queued);
+
+            mThreadPool->waitFor(future, std::chrono::milliseconds(1));
+        }
+    }
+
+    template <typename ResourceType>
+    void ResourceProvider::completeLoad(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, std::promise<const ResourceType&>& promise, std::exception_ptr error, FileRead* read) const
+    {
+        bool failed = error != nullptr;
+
+        if(failed)
+        {
+            promise.set_exception(error);
+        }
+        else
+        {
+            try
+            {
+                promise.set_value(read ? decodeResource<ResourceType>(sourceEntry, shard, stored, *read) : loadResource<ResourceType>(sourceEntry, shard, stored));
+            }
+            catch(...)
+            {
+                failed = true;
+                promise.set_exception(std::current_exception());
+            }
+        }
+
+        //only after the future is ready, so that listeners can take the result right away
+        stored.notifyListeners(failed);
+    }
+
+    template <typename ResourceType>
+    bool ResourceProvider::queueRead(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, std::shared_ptr<std::promise<const ResourceType&>> promise, int32_t priority, std::vector<ReadEngine::Request>& reads) const
+    {
+        if(!static_cast<TypedStore<ResourceType>&>(stored.storage).decodeFunction)
+            return false;
+
+        std::string path;
 
         try
         {
-            auto loadFunction = sourceEntry.loadingFunction.get<LoadingFunction<ResourceType>>();
-            auto resource = loadFunction(sourceEntry.source, resourceId);
+            path = sourceEntry.pathFunction(sourceEntry.source, stored.resourceId);
+        }
+        catch(...)
+        {
+            return false;
+        }
+
+        reads.push_back(ReadEngine::Request{std::move(path), [this, &sourceEntry, &shard, &stored, promise, priority] (FileRead& read)
+        {
+            auto buffer = std::make_shared<FileRead>(std::move(read));
+            auto queued = makeQueuedLoad([this, &sourceEntry, &shard, &stored, promise, buffer] ()
+            {
+                completeLoad<ResourceType>(sourceEntry, shard, stored, *promise, nullptr, buffer.get());
+            });
+
+            {
+                std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+                stored.queued = queued;
+            }
+
+            enqueueLoad(std::move(queued), priority);
+        }});
+
+        return true;
+    }
+
+    template <typename ResourceType>
+    const ResourceType& ResourceProvider::decodeResource(const SourceEntry& sourceEntry, ResourceShard& shard, StoredResource& stored, FileRead& read) const
+    {
+        try
+        {
+            if(read.error)
+                std::rethrow_exception(read.error);
+
+            auto& store = static_cast<TypedStore<ResourceType>&>(stored.storage);
+
+            return publishResource(sourceEntry, shard, stored, store.decodeFunction(sourceEntry.source, stored.resourceId, read.data.get(), read.size));
+        }
+        catch(const std::exception& exception)
+        {
+            throw InvalidResourceException(exception.what());
+        }
+    }
 
+    template <typename ResourceType>
+    void ResourceProvider::reloadResource(const SourceEntry& sourceEntry, const std::string& resourceId) const
+    {
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
+        auto& store = static_cast<TypedStore<ResourceType>&>(*sourceEntry.storage);
+
+        //a load in flight may have read the file before it changed, so it is let finish and replaced too
+        sourceEntry.waitFunction(*this, shard, resourceId);
+
+        StoredResource* stored = nullptr;
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+            auto resourceIter = shard.resources.find(resourceId);
+
+            if(resourceIter == shard.resources.end() || !resourceIter->second.value)
+                return;
+
+            stored = &resourceIter->second;
+        }
+
+        //loaded without any lock, so that the old version can be read meanwhile
+        ResourceType resource = [&] ()
+        {
+            try
+            {
+                return store.loadingFunction(sourceEntry.source, *stored);
+            }
+            catch(const std::exception& exception)
+            {
+                std::atomic_store(&stored->partial, std::shared_ptr<const void>());
+                throw InvalidResourceException(exception.what());
+            }
+        }();
+
+        std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+        std::atomic_store(&stored->partial, std::shared_ptr<const void>());
+
+        //it was unloaded meanwhile, and the next load reads the new file anyway
+        if(!stored->value)
+            return;
+
+        ResourceType* published = store.emplace(std::move(resource));
+        size_t size = store.sizeFunction(sourceEntry.source, *published);
+
+        //the old version stays charged until it is freed
+        stored->replaced.emplace_back(stored->value, stored->size);
+        stored->value = published;
+        stored->size = size;
+        //readers see either version whole, since the pointer is swapped in one go. they pin the entry before they look at it, like in unload, so the old version is only freed here if nobody can still be reading it
+        stored->resource.exchange(published);
+
+        sourceEntry.storage->usage += size;
+        mMemory->usage += size;
+
+        markReplacedUnused(*stored);
+        enforceBudgets(&sourceEntry, stored);
+    }
+
+    inline void ResourceProvider::releaseReplaced(StoredResource& stored)
+    {
+        size_t freed = 0;
+
+        for(auto& replaced : stored.replaced)
+            freed += replaced.second;
+
+        stored.replacedPending.store(false, std::memory_order_relaxed);
+        stored.storage.destroyReplaced(stored);
+        stored.storage.usage -= freed;
+
+        if(!stored.storage.detached)
+            stored.storage.memory->usage -= freed;
+    }
+
+    inline void ResourceProvider::markReplacedUnused(StoredResource& stored)
+    {
+        if(stored.replaced.empty())
+            return;
+
+        //flagged before the users are checked, and handles check the flag after letting go, so one of the two always frees the old versions
+        stored.replacedPending.store(true);
+
+        if(stored.users.load() == 0)
+            releaseReplaced(stored);
+    }
+
+    inline void ResourceProvider::finishReload(ResourceStorage& storage)
+    {
+        std::lock_guard<std::mutex> lock(storage.reloadMutex);
+
+        if(--storage.reloads == 0)
+            storage.reloadsDone.notify_all();
+    }
+
+    inline void ResourceProvider::drainReloads(ResourceStorage& storage)
+    {
+        std::unique_lock<std::mutex> lock(storage.reloadMutex);
+        storage.reloadsDone.wait(lock, [&storage] () { return storage.reloads == 0; });
+    }
+
+    inline std::unique_lock<std::mutex> ResourceProvider::lockFileWatch() const
+    {
+        if(!mFileWatch)
+            return std::unique_lock<std::mutex>();
+
+        return std::unique_lock<std::mutex>(mFileWatch->mutex);
+    }
+
+    inline void ResourceProvider::fileChanged(FileWatch& fileWatch, const std::string& path)
+    {
+        //held while the reloads are queued, so that the sources and the provider stay put
+        std::lock_guard<std::mutex> lock(fileWatch.mutex);
+        auto fileIter = fileWatch.files.find(path);
+
+        if(fileIter == fileWatch.files.end())
+            return;
+
+        //the futures are dropped, since a failed reload keeps the old version, which is all that can be done here
+        for(const auto& resource : fileIter->second)
+            fileWatch.provider->reload(resource.first, resource.second);
+    }
+
+    template <typename ResourceType>
+    std::shared_future<const ResourceType&>& ResourceProvider::asyncProcess(StoredResource& stored)
+    {
+        return *reinterpret_cast<std::shared_future<const ResourceType&>*>(&stored.asyncProcess);
+    }
+
+    template <typename ResourceType>
+    void ResourceProvider::setAsyncProcess(StoredResource& stored, std::shared_future<const ResourceType&> future)
+    {
+        if(stored.loading)
+        {
+            asyncProcess<ResourceType>(stored) = std::move(future);
+        }
+        else
+        {
+            new(&stored.asyncProcess) std::shared_future<const ResourceType&>(std::move(future));
+            stored.loading = true;
+        }
+    }
+
+    template <typename ResourceType>
+    AsyncResourceView<ResourceType> ResourceProvider::readyView(const std::string& resourceId, const ResourceType& resource, const ResourceHandle<ResourceType>& pinned)
+    {
+        std::promise<const ResourceType&> promise;
+        std::shared_future<const ResourceType&> future = promise.get_future();
+        promise.set_value(resource);
+        return AsyncResourceView<ResourceType>{resourceId, future, pinned};
+    }
+#endif
+
+    inline ResourceProvider::StoredResource& ResourceProvider::intern(ResourceShard& shard, ResourceStorage& storage, const std::string& sourceId, const std::string& resourceId) const
+    {
+        auto resourceIter = shard.resources.find(resourceId);
+
+        if(resourceIter != shard.resources.end())
+            return resourceIter->second;
+
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<SharedMutex> tableLock(shard.tableMutex);
+#endif
+        auto emplaced = shard.resources.emplace(std::piecewise_construct, std::forward_as_tuple(resourceId), std::forward_as_tuple(sourceId, resourceId, storage));
+
+        return emplaced.first->second;
+    }
+
+    template <typename ResourceType>
+    ResourceHandle<ResourceType> ResourceProvider::pin(StoredResource& stored)
+    {
+        return ResourceHandle<ResourceType>(std::shared_ptr<ResourceEntry>(stored.storage.shared_from_this(), &stored));
+    }
+
+    inline bool ResourceProvider::resident(const SourceEntry& sourceEntry, const std::string& resourceId)
+    {
+        ResourceShard& shard = sourceEntry.storage->shard(resourceId);
+
+#ifndef REX_DISABLE_ASYNC
+        SharedLock lock(shard.tableMutex);
+#endif
+        auto resourceIter = shard.resources.find(resourceId);
+
+        return resourceIter != shard.resources.end() && resourceIter->second.resource.load(std::memory_order_acquire) != nullptr;
+    }
+
+    inline std::vector<ResourceProvider::DependencyNode> ResourceProvider::missingDependencies(const SourceEntry& sourceEntry, const std::string& sourceId, const std::string& resourceId) const
+    {
+        std::vector<DependencyNode> nodes;
+        std::unordered_map<std::string, size_t> visited;
+        std::vector<std::string> path;
+
+        visitDependency(sourceEntry, Dependency{sourceId, resourceId}, nodes, visited, path);
+
+        return nodes;
+    }
+
+    inline size_t ResourceProvider::visitDependency(const SourceEntry& sourceEntry, const Dependency& dependency, std::vector<DependencyNode>& nodes, std::unordered_map<std::string, size_t>& visited, std::vector<std::string>& path) const
+    {
+        std::string key = dependency.sourceId + '\n' + dependency.resourceId;
+        auto visitedIter = visited.find(key);
+
+        if(visitedIter != visited.end())
+            return visitedIter->second;
+
+        if(std::find(path.begin(), path.end(), key) != path.end())
+            throw InvalidResourceException("resource '" + dependency.resourceId + "' in source '" + dependency.sourceId + "' depends on itself");
+
+        path.push_back(key);
+
+        std::vector<size_t> children;
+
+        if(sourceEntry.dependencyFunction)
+        {
+            for(const Dependency& child : sourceEntry.dependencyFunction(sourceEntry.source, dependency.resourceId))
+            {
+                const SourceEntry& childEntry = toSourceEntry(child.sourceId);
+
+                //what is already in doesn't have to be waited for, and neither does anything it needs
+                if(!resident(childEntry, child.resourceId))
+                    children.push_back(visitDependency(childEntry, child, nodes, visited, path));
+            }
+        }
+
+        path.pop_back();
+
+        size_t index = nodes.size();
+        nodes.push_back(DependencyNode{&sourceEntry, dependency, children.size(), {}});
+
+        for(size_t child : children)
+            nodes[child].dependents.push_back(index);
+
+        visited.emplace(std::move(key), index);
+
+        return index;
+    }
+
+    inline void ResourceProvider::loadDependencies(const SourceEntry& sourceEntry, const std::string& sourceId, const std::string& resourceId) const
+    {
+        std::vector<DependencyNode> nodes = missingDependencies(sourceEntry, sourceId, resourceId);
+
+        //the last one is the resource itself, which the caller loads
+        for(size_t index = 0; index + 1 < nodes.size(); ++index)
+        {
+            const DependencyNode& node = nodes[index];
+            node.sourceEntry->fetchFunction(*this, node.dependency.sourceId, node.dependency.resourceId);
+        }
+    }
+
+#ifndef REX_DISABLE_ASYNC
+    inline void ResourceProvider::startDependencies(std::shared_ptr<DependencyGraph> graph) const
+    {
+        size_t count = graph->nodes.size();
+        graph->remaining.reset(new std::atomic<size_t>[count]);
+
+        for(size_t index = 0; index < count; ++index)
+            graph->remaining[index] = graph->nodes[index].dependencyCount;
+
+        //collected first, since the counters start changing as soon as the first one is queued
+        std::vector<size_t> ready;
+
+        for(size_t index = 0; index + 1 < count; ++index)
+        {
+            if(graph->nodes[index].dependencyCount == 0)
+                ready.push_back(index);
+        }
+
+        for(size_t index : ready)
+        {
+            mThreadPool->enqueue([this, graph, index] ()
+            {
+                runDependency(graph, index);
+            }, graph->priority);
+        }
+    }
+
+    inline void ResourceProvider::runDependency(std::shared_ptr<DependencyGraph> graph, size_t index) const
+    {
+        const DependencyNode& node = graph->nodes[index];
+        bool failed;
+
+        {
+            std::lock_guard<std::mutex> lock(graph->mutex);
+            failed = graph->error != nullptr;
+        }
+
+        //once something failed, the rest is only counted down so that the resource that was asked for gets the error. the same goes once a waiter took over, since its source may be gone by now
+        if(!failed && !graph->load->claimed.load())
+        {
+            try
+            {
+                node.sourceEntry->fetchFunction(*this, node.dependency.sourceId, node.dependency.resourceId);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(graph->mutex);
+
+                if(!graph->error)
+                    graph->error = std::current_exception();
+            }
+        }
+
+        for(size_t dependent : node.dependents)
+        {
+            if(--graph->remaining[dependent] != 0)
+                continue;
+
+            //the last dependency to finish carries on with the resource that was asked for, while other dependents are queued
+            if(dependent + 1 == graph->nodes.size())
+            {
+                std::exception_ptr error;
+
+                {
+                    std::lock_guard<std::mutex> lock(graph->mutex);
+                    error = graph->error;
+                }
+
+                graph->finish(error);
+            }
+            else
+            {
+                mThreadPool->enqueue([this, graph, dependent] ()
+                {
+                    runDependency(graph, dependent);
+                }, graph->priority);
+            }
+        }
+    }
+#endif
+
+    inline size_t ResourceProvider::unload(StoredResource& stored)
+    {
+        if(!stored.value)
+            return 0;
+
+        //readers pin the entry before they look at the resource, so once it is hidden it is safe to drop as long as there are still no users
+        const void* resource = stored.resource.exchange(nullptr);
+
+        if(stored.users.load() > 0)
+        {
+            stored.resource.store(resource, std::memory_order_release);
+            return 0;
+        }
+
+        size_t freed = stored.size;
+
+        stored.storage.destroyValue(stored);
+        stored.size = 0;
+        stored.unusedPending.store(false, std::memory_order_relaxed);
+
+        stored.storage.usage -= freed;
+
+        if(!stored.storage.detached)
+            stored.storage.memory->usage -= freed;
+
+        return freed;
+    }
+
+    inline bool ResourceProvider::releaseAll(ResourceStorage& storage)
+    {
 #ifndef REX_DISABLE_ASYNC
+        //always taken in shard order, and nothing else waits for a second shard while holding one
+        std::array<std::unique_lock<std::recursive_mutex>, ResourceStorage::ShardCount> locks;
+
+        for(size_t index = 0; index < ResourceStorage::ShardCount; ++index)
+            locks[index] = std::unique_lock<std::recursive_mutex>(storage.shards[index].loadMutex);
+#endif
+        //every resource is hidden before its users are checked, like in unload, so that nobody can pin one behind our back
+        std::vector<std::pair<StoredResource*, const void*>> hidden;
+        bool inUse = false;
+
+        for(auto& shard : storage.shards)
+        {
+            for(auto& resourceIter : shard.resources)
             {
-                std::lock_guard<std::recursive_mutex> lock(*mResourceMutex);
-                auto emplaced = mResources.at(sourceId).emplace(resourceId, std::move(resource));
+                StoredResource& stored = resourceIter.second;
+
+                if(!stored.value)
+                    continue;
 
-                mAsyncProcesses.at(sourceId).erase(resourceId);
+                hidden.emplace_back(&stored, stored.resource.exchange(nullptr));
 
-                return emplaced.first->second.template get<ResourceType>();
+                if(stored.users.load() > 0)
+                {
+                    inUse = true;
+                    break;
+                }
             }
-#else
-			auto emplaced = mResources.at(sourceId).emplace(resourceId, std::move(resource));
-			return emplaced.first->second.template get<ResourceType>();
+
+            if(inUse)
+                break;
+        }
+
+        if(inUse)
+        {
+            for(auto& entry : hidden)
+                entry.first->resource.store(entry.second, std::memory_order_release);
+
+            return false;
+        }
+
+        size_t freed = 0;
+
+        for(auto& shard : storage.shards)
+        {
+            for(auto& resourceIter : shard.resources)
+            {
+                StoredResource& stored = resourceIter.second;
+
+                freed += stored.size;
+                stored.size = 0;
+                stored.unusedPending.store(false, std::memory_order_relaxed);
+#ifndef REX_DISABLE_ASYNC
+                storage.clearAsyncProcess(stored);
+
+                for(auto& replaced : stored.replaced)
+                    freed += replaced.second;
 #endif
+            }
         }
-        catch(const std::exception& exception)
+
+        storage.destroyAllValues();
+        storage.usage -= freed;
+
+        if(!storage.detached)
+            storage.memory->usage -= freed;
+
+        return true;
+    }
+
+    inline void ResourceProvider::detach(ResourceStorage& storage)
+    {
+#ifndef REX_DISABLE_ASYNC
+        //unloads that handles trigger hold a shard, so with all of them held none can count against the budget twice
+        std::array<std::unique_lock<std::recursive_mutex>, ResourceStorage::ShardCount> locks;
+
+        for(size_t index = 0; index < ResourceStorage::ShardCount; ++index)
+            locks[index] = std::unique_lock<std::recursive_mutex>(storage.shards[index].loadMutex);
+#endif
+        storage.detached = true;
+        storage.memory->usage -= storage.usage;
+    }
+
+    inline void ResourceProvider::markUnused(StoredResource& stored)
+    {
+        if(!stored.value)
+            return;
+
+        //flagged before the users are checked, and handles check the flag after letting go, so one of the two always sees the other
+        stored.unusedPending.store(true);
+        unload(stored);
+    }
+
+    inline void ResourceProvider::releaseUnused(ResourceEntry& entry)
+    {
+        StoredResource& stored = static_cast<StoredResource&>(entry);
+
+#ifndef REX_DISABLE_ASYNC
+        std::lock_guard<std::recursive_mutex> lock(stored.storage.shard(stored.resourceId).loadMutex);
+#endif
+        //a new handle may have been taken in the meantime, in which case it is the one to release it
+        if(stored.unusedPending)
+            unload(stored);
+#ifndef REX_DISABLE_ASYNC
+        if(stored.replacedPending && stored.users.load() == 0)
+            releaseReplaced(stored);
+#endif
+    }
+
+    inline void ResourceProvider::enforceBudgets(const SourceEntry* sourceEntry, const StoredResource* keep) const
+    {
+        if(sourceEntry)
         {
-            throw InvalidResourceException(exception.what());
+            size_t budget = sourceEntry->storage->budget;
+            size_t usage = sourceEntry->storage->usage;
+
+            if(budget != 0 && usage > budget)
+                evict(*sourceEntry, usage - budget, keep);
+        }
+
+        size_t budget = mMemory->budget;
+
+        if(budget != 0)
+        {
+            for(const auto& source : mSources)
+            {
+                size_t usage = mMemory->usage;
+
+                if(usage <= budget)
+                    break;
+
+                evict(source.second, usage - budget, keep);
+            }
         }
     }
 
+    inline size_t ResourceProvider::evict(const SourceEntry& sourceEntry, size_t bytes, const StoredResource* keep) const
+    {
+        ResourceStorage& storage = *sourceEntry.storage;
+        size_t freed = 0;
+
+        //CLOCK: the sweep clears the referenced flag of resources and drops those that have not been used since it last passed, so two laps over the shards are enough
+        for(size_t step = 0; step < ResourceStorage::ShardCount * 2 && freed < bytes; ++step)
+        {
+            ResourceShard& shard = storage.shards[storage.clockHand++ % ResourceStorage::ShardCount];
+
+#ifndef REX_DISABLE_ASYNC
+            //busy shards are skipped instead of waited for, which also means that evicting never deadlocks against another thread holding a shard
+            std::unique_lock<std::recursive_mutex> lock(shard.loadMutex, std::try_to_lock);
+
+            if(!lock.owns_lock())
+                continue;
+#endif
+
+            for(auto& resourceIter : shard.resources)
+            {
+                StoredResource& stored = resourceIter.second;
+
+                if(freed >= bytes)
+                    break;
+
+                if(!stored.value || &stored == keep || stored.users.load(std::memory_order_relaxed) > 0)
+                    continue;
+
+                if(stored.referenced.exchange(false, std::memory_order_relaxed))
+                    continue;
+
+                freed += unload(stored);
+            }
+        }
+
+        return freed;
+    }
+
     inline void ResourceProvider::waitForSourceAsync(const std::string& sourceId) const
     {
 #ifndef REX_DISABLE_ASYNC
@@ -444,8 +2066,23 @@ namespace rex
         {
             auto waitFunction = sourceIterator->second.waitFunction;
 
-            for(auto& asyncIter : mAsyncProcesses.at(sourceId))
-                waitFunction(asyncIter.second);
+            for(auto& shard : sourceIterator->second.storage->shards)
+            {
+                std::vector<std::string> inProgress;
+
+                {
+                    std::lock_guard<std::recursive_mutex> lock(shard.loadMutex);
+
+                    for(const auto& resourceIter : shard.resources)
+                    {
+                        if(resourceIter.second.loading)
+                            inProgress.push_back(resourceIter.first);
+                    }
+                }
+
+                for(const auto& resourceId : inProgress)
+                    waitFunction(*this, shard, resourceId);
+            }
         }
 #endif
     }
@@ -1,13 +1,16 @@
 #pragma once
 #include <rex/config.hpp>
 #include <string>
+#include <rex/resourcehandle.hpp>
 
 namespace rex
 {
+    //the view keeps the resource alive, so it stays valid even if the resource is marked as unused meanwhile
     template <typename ResourceType>
     struct ResourceView
     {
         std::string identifier;
         const ResourceType& resource;
+        ResourceHandle<ResourceType> handle;
     };
 }
@@ -1,27 +1,33 @@
 #pragma once
-#include <rex/filesource.hpp>
+#include <rex/mappedfilesource.hpp>
 #include <SFML/Graphics/Image.hpp>
 
 namespace rex
 {
     namespace sf
     {
-        class ImageFileSource : public rex::FileSource<::sf::Image>
+        class ImageFileSource : public rex::MappedFileSource<::sf::Image>
         {
             public:
-                using rex::FileSource<::sf::Image>::FileSource;
+                using rex::MappedFileSource<::sf::Image>::MappedFileSource;
         
-                ::sf::Image loadFromFile(const Path& path) const override
+                ::sf::Image loadFromMemory(const char* data, size_t size) const override
                 {
                     ::sf::Image image;
 
-                    if(!image.loadFromFile(path))
+                    if(!image.loadFromMemory(data, size))
                     {
-                        throw rex::InvalidResourceException("cannot open image file '" + path.str() + "'");
+                        throw rex::InvalidResourceException("cannot decode image file");
                     }
 
                     return image;
                 }
+
+                size_t estimateSize(const ::sf::Image& image) const
+                {
+                    ::sf::Vector2u size = image.getSize();
+                    return sizeof(::sf::Image) + size.x * size.y * 4;
+                }
         };
     }
 }
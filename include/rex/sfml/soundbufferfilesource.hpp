@@ -1,27 +1,32 @@
 #pragma once
-#include <rex/filesource.hpp>
+#include <rex/mappedfilesource.hpp>
 #include <SFML/Audio/SoundBuffer.hpp>
 
 namespace rex
 {
     namespace sf
     {
-        class SoundBufferFileSource : public rex::FileSource<::sf::SoundBuffer>
+        class SoundBufferFileSource : public rex::MappedFileSource<::sf::SoundBuffer>
         {
             public:
-                using rex::FileSource<::sf::SoundBuffer>::FileSource;
+                using rex::MappedFileSource<::sf::SoundBuffer>::MappedFileSource;
         
-                ::sf::SoundBuffer loadFromFile(const Path& path) const override
+                ::sf::SoundBuffer loadFromMemory(const char* data, size_t size) const override
                 {
                     ::sf::SoundBuffer soundBuffer;
 
-                    if(!soundBuffer.loadFromFile(path))
+                    if(!soundBuffer.loadFromMemory(data, size))
                     {
-                        throw rex::InvalidResourceException("cannot open sound buffer file '" + path.str() + "'");
+                        throw rex::InvalidResourceException("cannot decode sound buffer file");
                     }
 
                     return soundBuffer;
                 }
+
+                size_t estimateSize(const ::sf::SoundBuffer& soundBuffer) const
+                {
+                    return sizeof(::sf::SoundBuffer) + soundBuffer.getSampleCount() * sizeof(::sf::Int16);
+                }
         };
     }
 }
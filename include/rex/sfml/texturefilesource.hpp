@@ -1,27 +1,33 @@
 #pragma once
-#include <rex/filesource.hpp>
+#include <rex/mappedfilesource.hpp>
 #include <SFML/Graphics/Texture.hpp>
 
 namespace rex
 {
     namespace sf
     {
-        class TextureFileSource : public rex::FileSource<::sf::Texture>
+        class TextureFileSource : public rex::MappedFileSource<::sf::Texture>
         {
             public:
-                using rex::FileSource<::sf::Texture>::FileSource;
+                using rex::MappedFileSource<::sf::Texture>::MappedFileSource;
         
-                ::sf::Texture loadFromFile(const Path& path) const override
+                ::sf::Texture loadFromMemory(const char* data, size_t size) const override
                 {
                     ::sf::Texture texture;
 
-                    if(!texture.loadFromFile(path))
+                    if(!texture.loadFromMemory(data, size))
                     {
-                        throw rex::InvalidResourceException("cannot open texture file '" + path.str() + "'");
+                        throw rex::InvalidResourceException("cannot decode texture file");
                     }
 
                     return texture;
                 }
+
+                size_t estimateSize(const ::sf::Texture& texture) const
+                {
+                    ::sf::Vector2u size = texture.getSize();
+                    return sizeof(::sf::Texture) + size.x * size.y * 4;
+                }
         };
     }
 }
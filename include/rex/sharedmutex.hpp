@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace rex
+{
+    //a small reader/writer lock. readers only ever touch a shared atomic counter, and a waiting writer blocks new readers so it cannot be starved
+    class SharedMutex
+    {
+        public:
+            SharedMutex();
+            SharedMutex(const SharedMutex& other) = delete;
+            SharedMutex& operator=(const SharedMutex& other) = delete;
+            void lock();
+            bool try_lock();
+            void unlock();
+            void lock_shared();
+            bool try_lock_shared();
+            void unlock_shared();
+        private:
+            static constexpr uint32_t Writer = 1u << 31;
+            static constexpr uint32_t WriterWaiting = 1u << 30;
+            std::atomic<uint32_t> mState;
+    };
+
+    class SharedLock
+    {
+        public:
+            SharedLock(SharedMutex& mutex);
+            SharedLock(const SharedLock& other) = delete;
+            SharedLock& operator=(const SharedLock& other) = delete;
+            ~SharedLock();
+        private:
+            SharedMutex& mMutex;
+    };
+
+    inline SharedMutex::SharedMutex():
+        mState(0)
+    {
+    }
+
+    inline void SharedMutex::lock()
+    {
+        while(!try_lock())
+        {
+            mState.fetch_or(WriterWaiting, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    }
+
+    inline bool SharedMutex::try_lock()
+    {
+        uint32_t state = mState.load(std::memory_order_relaxed);
+
+        //a writer may take over a waiting flag set by itself or another writer, the others will just set it again
+        if((state & ~WriterWaiting) != 0)
+            return false;
+
+        return mState.compare_exchange_strong(state, Writer, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    inline void SharedMutex::unlock()
+    {
+        mState.fetch_and(~Writer, std::memory_order_release);
+    }
+
+    inline void SharedMutex::lock_shared()
+    {
+        while(!try_lock_shared())
+            std::this_thread::yield();
+    }
+
+    inline bool SharedMutex::try_lock_shared()
+    {
+        uint32_t state = mState.load(std::memory_order_relaxed);
+
+        while((state & (Writer | WriterWaiting)) == 0)
+        {
+            if(mState.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+
+        return false;
+    }
+
+    inline void SharedMutex::unlock_shared()
+    {
+        mState.fetch_sub(1, std::memory_order_release);
+    }
+
+    inline SharedLock::SharedLock(SharedMutex& mutex):
+        mMutex(mutex)
+    {
+        mMutex.lock_shared();
+    }
+
+    inline SharedLock::~SharedLock()
+    {
+        mMutex.unlock_shared();
+    }
+}
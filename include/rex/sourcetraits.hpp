@@ -0,0 +1,149 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rex
+{
+    //sources can optionally provide 'size_t estimateSize(const ResourceType&) const' to tell how much memory a loaded resource occupies
+    template <typename SourceType, typename ResourceType>
+    class HasSizeEstimate
+    {
+        template <typename Source>
+        static auto test(int) -> decltype(std::declval<const Source&>().estimateSize(std::declval<const ResourceType&>()), std::true_type());
+        template <typename Source>
+        static std::false_type test(...);
+        public:
+            static constexpr bool value = decltype(test<SourceType>(0))::value;
+    };
+
+    template <typename SourceType, typename ResourceType>
+    typename std::enable_if<HasSizeEstimate<SourceType, ResourceType>::value, size_t>::type estimateSize(const SourceType& source, const ResourceType& resource)
+    {
+        return source.estimateSize(resource);
+    }
+
+    template <typename SourceType, typename ResourceType>
+    typename std::enable_if<!HasSizeEstimate<SourceType, ResourceType>::value, size_t>::type estimateSize(const SourceType& source, const ResourceType& resource)
+    {
+        return sizeof(ResourceType);
+    }
+
+    //sources can optionally provide 'static constexpr size_t arenaChunk' to keep their resources in an arena of chunks that many resources each, which markAllUnused gives back in one go. it suits sources of many small resources
+    template <typename SourceType>
+    class ArenaChunk
+    {
+        template <typename Source>
+        static std::integral_constant<size_t, Source::arenaChunk> test(int);
+        template <typename Source>
+        static std::integral_constant<size_t, 0> test(...);
+        public:
+            static constexpr size_t value = decltype(test<SourceType>(0))::value;
+    };
+
+    struct Dependency
+    {
+        std::string sourceId;
+        std::string resourceId;
+    };
+
+    //sources can optionally provide 'std::vector<Dependency> dependencies(const std::string& id) const' to name the resources that a resource needs. those are loaded before it, so a loader can get them from the provider without waiting
+    template <typename SourceType>
+    class HasDependencies
+    {
+        template <typename Source>
+        static auto test(int) -> decltype(std::declval<const Source&>().dependencies(std::string()), std::true_type());
+        template <typename Source>
+        static std::false_type test(...);
+        public:
+            static constexpr bool value = decltype(test<SourceType>(0))::value;
+    };
+
+    template <typename SourceType>
+    typename std::enable_if<HasDependencies<SourceType>::value, std::vector<Dependency>>::type dependencies(const SourceType& source, const std::string& id)
+    {
+        return source.dependencies(id);
+    }
+
+    template <typename SourceType>
+    typename std::enable_if<!HasDependencies<SourceType>::value, std::vector<Dependency>>::type dependencies(const SourceType& source, const std::string& id)
+    {
+        return {};
+    }
+
+    //sources can optionally provide 'ResourceType loadProgressively(const std::string& id, const std::function<void(ResourceType)>& publish) const', which is then used instead of load. it can publish lower detail versions of the resource while the rest of it loads, and those can be looked at with ResourceProvider::partial until it is done
+    template <typename SourceType, typename ResourceType>
+    class HasProgressiveLoad
+    {
+        template <typename Source>
+        static auto test(int) -> decltype(std::declval<const Source&>().loadProgressively(std::string(), std::declval<const std::function<void(ResourceType)>&>()), std::true_type());
+        template <typename Source>
+        static std::false_type test(...);
+        public:
+            static constexpr bool value = decltype(test<SourceType>(0))::value;
+    };
+
+    template <typename SourceType, typename ResourceType>
+    typename std::enable_if<HasProgressiveLoad<SourceType, ResourceType>::value, ResourceType>::type loadProgressively(const SourceType& source, const std::string& id, const std::function<void(ResourceType)>& publish)
+    {
+        return source.loadProgressively(id, publish);
+    }
+
+    template <typename SourceType, typename ResourceType>
+    typename std::enable_if<!HasProgressiveLoad<SourceType, ResourceType>::value, ResourceType>::type loadProgressively(const SourceType& source, const std::string& id, const std::function<void(ResourceType)>& publish)
+    {
+        return source.load(id);
+    }
+
+    //sources can optionally provide 'std::string filePath(const std::string& id) const' to name the file that a resource is loaded from. ResourceProvider::watchFiles can then reload the resources whose files change
+    template <typename SourceType>
+    class HasFilePath
+    {
+        template <typename Source>
+        static auto test(int) -> decltype(std::string(std::declval<const Source&>().filePath(std::string())), std::true_type());
+        template <typename Source>
+        static std::false_type test(...);
+        public:
+            static constexpr bool value = decltype(test<SourceType>(0))::value;
+    };
+
+    template <typename SourceType>
+    typename std::enable_if<HasFilePath<SourceType>::value, std::string>::type filePath(const SourceType& source, const std::string& id)
+    {
+        return source.filePath(id);
+    }
+
+    template <typename SourceType>
+    typename std::enable_if<!HasFilePath<SourceType>::value, std::string>::type filePath(const SourceType& source, const std::string& id)
+    {
+        return std::string();
+    }
+
+    //sources can optionally provide 'std::string filePath(const std::string& id) const' and 'ResourceType decode(const std::string& id, const char* data, size_t size) const' to be loaded in two stages. asyncGet then reads the files of a batch in the background, with many reads in flight at once, and only the decoding takes a worker
+    template <typename SourceType, typename ResourceType>
+    class HasFileStages
+    {
+        template <typename Source>
+        static auto test(int) -> decltype(std::string(std::declval<const Source&>().filePath(std::string())), ResourceType(std::declval<const Source&>().decode(std::string(), static_cast<const char*>(nullptr), size_t())), std::true_type());
+        template <typename Source>
+        static std::false_type test(...);
+        public:
+            static constexpr bool value = decltype(test<SourceType>(0))::value;
+    };
+
+    template <typename SourceType, typename ResourceType>
+    typename std::enable_if<HasFileStages<SourceType, ResourceType>::value, ResourceType>::type decode(const SourceType& source, const std::string& id, const char* data, size_t size)
+    {
+        return source.decode(id, data, size);
+    }
+
+    template <typename SourceType, typename ResourceType>
+    typename std::enable_if<!HasFileStages<SourceType, ResourceType>::value, ResourceType>::type decode(const SourceType& source, const std::string& id, const char* data, size_t size)
+    {
+        return source.load(id);
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <rex/config.hpp>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace rex
+{
+    //non owning view of characters in a string that outlives it, which converts to a std::string wherever one is needed
+    class StringView
+    {
+        public:
+            StringView();
+            StringView(const char* data, size_t size);
+            StringView(const std::string& text);
+            const char* data() const;
+            size_t size() const;
+            bool empty() const;
+            const char* begin() const;
+            const char* end() const;
+            std::string str() const;
+            operator std::string() const;
+        private:
+            const char* mData;
+            size_t mSize;
+    };
+
+    inline StringView::StringView():
+        mData(""),
+        mSize(0)
+    {
+    }
+
+    inline StringView::StringView(const char* data, size_t size):
+        mData(data),
+        mSize(size)
+    {
+    }
+
+    inline StringView::StringView(const std::string& text):
+        mData(text.data()),
+        mSize(text.size())
+    {
+    }
+
+    inline const char* StringView::data() const
+    {
+        return mData;
+    }
+
+    inline size_t StringView::size() const
+    {
+        return mSize;
+    }
+
+    inline bool StringView::empty() const
+    {
+        return mSize == 0;
+    }
+
+    inline const char* StringView::begin() const
+    {
+        return mData;
+    }
+
+    inline const char* StringView::end() const
+    {
+        return mData + mSize;
+    }
+
+    inline std::string StringView::str() const
+    {
+        return std::string(mData, mSize);
+    }
+
+    inline StringView::operator std::string() const
+    {
+        return str();
+    }
+
+    inline bool operator==(const StringView& a, const StringView& b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+    }
+
+    inline bool operator!=(const StringView& a, const StringView& b)
+    {
+        return !(a == b);
+    }
+
+    inline bool operator==(const StringView& a, const char* b)
+    {
+        return a == StringView(b, std::strlen(b));
+    }
+
+    inline bool operator!=(const StringView& a, const char* b)
+    {
+        return !(a == b);
+    }
+
+    inline bool operator==(const char* a, const StringView& b)
+    {
+        return b == a;
+    }
+
+    inline bool operator!=(const char* a, const StringView& b)
+    {
+        return !(b == a);
+    }
+
+    inline std::ostream& operator<<(std::ostream& out, const StringView& view)
+    {
+        return out.write(view.data(), static_cast<std::streamsize>(view.size()));
+    }
+}
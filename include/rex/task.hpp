@@ -0,0 +1,448 @@
+#pragma once
+#include <rex/config.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rex
+{
+    //memory for tasks and the state they share with their futures. freed blocks go to a free list of their size instead of back to the heap, so once the program has warmed up, submitting work doesn't allocate
+    class TaskMemory
+    {
+        public:
+            //blocks bigger than this come straight from the heap
+            static constexpr size_t LargestBlock = 512;
+            static void* allocate(size_t size);
+            static void release(void* block, size_t size);
+        private:
+            struct FreeBlock
+            {
+                FreeBlock* next;
+            };
+
+            struct SizeClass
+            {
+                std::mutex mutex;
+                FreeBlock* free;
+            };
+
+            static constexpr size_t ClassCount = 4;
+            static size_t classIndex(size_t size);
+            static size_t classSize(size_t index);
+            static SizeClass* sizeClasses();
+    };
+
+    //hands out TaskMemory, for the shared state of promises and the like
+    template <typename Type>
+    class TaskAllocator
+    {
+        public:
+            using value_type = Type;
+            TaskAllocator();
+            template <typename Other>
+            TaskAllocator(const TaskAllocator<Other>& other);
+            Type* allocate(size_t count);
+            void deallocate(Type* pointer, size_t count);
+    };
+
+    template <typename Type, typename Other>
+    bool operator==(const TaskAllocator<Type>& a, const TaskAllocator<Other>& b);
+    template <typename Type, typename Other>
+    bool operator!=(const TaskAllocator<Type>& a, const TaskAllocator<Other>& b);
+
+    //a move only 'void()' callable. functions that fit are kept in place and bigger ones in TaskMemory, so unlike std::function it never allocates on its own
+    class Task
+    {
+        public:
+            static constexpr size_t InlineSize = 96;
+            Task();
+            template <typename Function, typename = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, Task>::value>::type>
+            Task(Function&& function);
+            Task(const Task& other) = delete;
+            Task& operator=(const Task& other) = delete;
+            Task(Task&& other) noexcept;
+            Task& operator=(Task&& other) noexcept;
+            ~Task();
+            void operator()();
+            explicit operator bool() const;
+        private:
+            struct Operations
+            {
+                void (*invoke)(void* storage);
+                //moves into uninitialised storage and destroys what was moved from
+                void (*relocate)(void* from, void* to);
+                void (*destroy)(void* storage);
+            };
+
+            template <typename Function>
+            struct InPlace
+            {
+                static void invoke(void* storage);
+                static void relocate(void* from, void* to);
+                static void destroy(void* storage);
+                static const Operations operations;
+            };
+
+            //the storage holds a pointer to the function
+            template <typename Function>
+            struct Pooled
+            {
+                static void invoke(void* storage);
+                static void relocate(void* from, void* to);
+                static void destroy(void* storage);
+                static const Operations operations;
+            };
+
+            //chosen at compile time, so that functions too big for the storage are never constructed in it
+            template <typename Function>
+            struct FitsInPlace : std::integral_constant<bool, sizeof(Function) <= InlineSize && alignof(Function) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<Function>::value>
+            {
+            };
+
+            template <typename Function>
+            void store(Function&& function, std::true_type inPlace);
+            template <typename Function>
+            void store(Function&& function, std::false_type inPlace);
+            void reset();
+
+            typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type mStorage;
+            const Operations* mOperations;
+    };
+
+    //a queue of tasks, or of entries that hold them, that can be taken from either end. it keeps its memory when emptied, so once it has grown to fit, pushing and popping don't allocate
+    template <typename Entry>
+    class TaskRing
+    {
+        public:
+            TaskRing();
+            bool empty() const;
+            size_t size() const;
+            //counted from the front
+            const Entry& operator[](size_t index) const;
+            void pushBack(Entry&& entry);
+            Entry popFront();
+            Entry popBack();
+            //takes an entry out of the middle, moving the ones behind it up
+            Entry take(size_t index);
+        private:
+            void grow();
+
+            std::vector<Entry> mSlots;
+            size_t mHead;
+            size_t mSize;
+    };
+
+    inline void* TaskMemory::allocate(size_t size)
+    {
+        size_t index = classIndex(size);
+
+        if(index == ClassCount)
+            return ::operator new(size);
+
+        SizeClass& sizeClass = sizeClasses()[index];
+
+        {
+            std::lock_guard<std::mutex> lock(sizeClass.mutex);
+            FreeBlock* block = sizeClass.free;
+
+            if(block)
+            {
+                sizeClass.free = block->next;
+                return block;
+            }
+        }
+
+        return ::operator new(classSize(index));
+    }
+
+    inline void TaskMemory::release(void* block, size_t size)
+    {
+        size_t index = classIndex(size);
+
+        if(index == ClassCount)
+        {
+            ::operator delete(block);
+            return;
+        }
+
+        SizeClass& sizeClass = sizeClasses()[index];
+        FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+        freeBlock->next = sizeClass.free;
+        sizeClass.free = freeBlock;
+    }
+
+    inline size_t TaskMemory::classIndex(size_t size)
+    {
+        size_t index = 0;
+
+        while(index < ClassCount && size > classSize(index))
+            ++index;
+
+        return index;
+    }
+
+    inline size_t TaskMemory::classSize(size_t index)
+    {
+        return LargestBlock >> (ClassCount - 1 - index);
+    }
+
+    inline TaskMemory::SizeClass* TaskMemory::sizeClasses()
+    {
+        //never destroyed, since futures may still give back their state while the program exits
+        static SizeClass* sizeClasses = new SizeClass[ClassCount]();
+        return sizeClasses;
+    }
+
+    template <typename Type>
+    TaskAllocator<Type>::TaskAllocator()
+    {
+    }
+
+    template <typename Type>
+    template <typename Other>
+    TaskAllocator<Type>::TaskAllocator(const TaskAllocator<Other>& other)
+    {
+    }
+
+    template <typename Type>
+    Type* TaskAllocator<Type>::allocate(size_t count)
+    {
+        return static_cast<Type*>(TaskMemory::allocate(count * sizeof(Type)));
+    }
+
+    template <typename Type>
+    void TaskAllocator<Type>::deallocate(Type* pointer, size_t count)
+    {
+        TaskMemory::release(pointer, count * sizeof(Type));
+    }
+
+    template <typename Type, typename Other>
+    bool operator==(const TaskAllocator<Type>& a, const TaskAllocator<Other>& b)
+    {
+        return true;
+    }
+
+    template <typename Type, typename Other>
+    bool operator!=(const TaskAllocator<Type>& a, const TaskAllocator<Other>& b)
+    {
+        return false;
+    }
+
+    template <typename Function>
+    const Task::Operations Task::InPlace<Function>::operations = {&InPlace<Function>::invoke, &InPlace<Function>::relocate, &InPlace<Function>::destroy};
+
+    template <typename Function>
+    const Task::Operations Task::Pooled<Function>::operations = {&Pooled<Function>::invoke, &Pooled<Function>::relocate, &Pooled<Function>::destroy};
+
+    inline Task::Task():
+        mOperations(nullptr)
+    {
+    }
+
+    template <typename Function, typename>
+    Task::Task(Function&& function)
+    {
+        store(std::forward<Function>(function), FitsInPlace<typename std::decay<Function>::type>());
+    }
+
+    inline Task::Task(Task&& other) noexcept:
+        mOperations(other.mOperations)
+    {
+        if(mOperations)
+        {
+            mOperations->relocate(&other.mStorage, &mStorage);
+            other.mOperations = nullptr;
+        }
+    }
+
+    inline Task& Task::operator=(Task&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+
+            if(other.mOperations)
+            {
+                other.mOperations->relocate(&other.mStorage, &mStorage);
+                mOperations = other.mOperations;
+                other.mOperations = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    inline Task::~Task()
+    {
+        reset();
+    }
+
+    template <typename Function>
+    void Task::store(Function&& function, std::true_type inPlace)
+    {
+        using Stored = typename std::decay<Function>::type;
+
+        new(&mStorage) Stored(std::forward<Function>(function));
+        mOperations = &InPlace<Stored>::operations;
+    }
+
+    template <typename Function>
+    void Task::store(Function&& function, std::false_type inPlace)
+    {
+        using Stored = typename std::decay<Function>::type;
+        void* block = TaskMemory::allocate(sizeof(Stored));
+
+        try
+        {
+            *reinterpret_cast<Stored**>(&mStorage) = new(block) Stored(std::forward<Function>(function));
+        }
+        catch(...)
+        {
+            TaskMemory::release(block, sizeof(Stored));
+            throw;
+        }
+
+        mOperations = &Pooled<Stored>::operations;
+    }
+
+    inline void Task::operator()()
+    {
+        mOperations->invoke(&mStorage);
+    }
+
+    inline Task::operator bool() const
+    {
+        return mOperations != nullptr;
+    }
+
+    inline void Task::reset()
+    {
+        if(mOperations)
+        {
+            mOperations->destroy(&mStorage);
+            mOperations = nullptr;
+        }
+    }
+
+    template <typename Function>
+    void Task::InPlace<Function>::invoke(void* storage)
+    {
+        (*static_cast<Function*>(storage))();
+    }
+
+    template <typename Function>
+    void Task::InPlace<Function>::relocate(void* from, void* to)
+    {
+        Function& function = *static_cast<Function*>(from);
+        new(to) Function(std::move(function));
+        function.~Function();
+    }
+
+    template <typename Function>
+    void Task::InPlace<Function>::destroy(void* storage)
+    {
+        static_cast<Function*>(storage)->~Function();
+    }
+
+    template <typename Function>
+    void Task::Pooled<Function>::invoke(void* storage)
+    {
+        (**static_cast<Function**>(storage))();
+    }
+
+    template <typename Function>
+    void Task::Pooled<Function>::relocate(void* from, void* to)
+    {
+        *static_cast<Function**>(to) = *static_cast<Function**>(from);
+    }
+
+    template <typename Function>
+    void Task::Pooled<Function>::destroy(void* storage)
+    {
+        Function* function = *static_cast<Function**>(storage);
+        function->~Function();
+        TaskMemory::release(function, sizeof(Function));
+    }
+
+    template <typename Entry>
+    TaskRing<Entry>::TaskRing():
+        mHead(0),
+        mSize(0)
+    {
+    }
+
+    template <typename Entry>
+    bool TaskRing<Entry>::empty() const
+    {
+        return mSize == 0;
+    }
+
+    template <typename Entry>
+    size_t TaskRing<Entry>::size() const
+    {
+        return mSize;
+    }
+
+    template <typename Entry>
+    const Entry& TaskRing<Entry>::operator[](size_t index) const
+    {
+        return mSlots[(mHead + index) % mSlots.size()];
+    }
+
+    template <typename Entry>
+    void TaskRing<Entry>::pushBack(Entry&& entry)
+    {
+        if(mSize == mSlots.size())
+            grow();
+
+        mSlots[(mHead + mSize) % mSlots.size()] = std::move(entry);
+        ++mSize;
+    }
+
+    template <typename Entry>
+    Entry TaskRing<Entry>::popFront()
+    {
+        Entry entry = std::move(mSlots[mHead]);
+        mHead = (mHead + 1) % mSlots.size();
+        --mSize;
+        return entry;
+    }
+
+    template <typename Entry>
+    Entry TaskRing<Entry>::popBack()
+    {
+        Entry entry = std::move(mSlots[(mHead + mSize - 1) % mSlots.size()]);
+        --mSize;
+        return entry;
+    }
+
+    template <typename Entry>
+    Entry TaskRing<Entry>::take(size_t index)
+    {
+        Entry entry = std::move(mSlots[(mHead + index) % mSlots.size()]);
+
+        for(size_t i = index; i + 1 < mSize; ++i)
+            mSlots[(mHead + i) % mSlots.size()] = std::move(mSlots[(mHead + i + 1) % mSlots.size()]);
+
+        --mSize;
+        return entry;
+    }
+
+    template <typename Entry>
+    void TaskRing<Entry>::grow()
+    {
+        std::vector<Entry> slots(std::max<size_t>(mSlots.size() * 2, 16));
+
+        for(size_t i = 0; i < mSize; ++i)
+            slots[i] = std::move(mSlots[(mHead + i) % mSlots.size()]);
+
+        mSlots = std::move(slots);
+        mHead = 0;
+    }
+}
@@ -1,107 +1,243 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
 #include <vector>
+#include <deque>
 #include <thread>
+#include <cstdint>
 #include <queue>
 #include <mutex>
+#include <atomic>
+#include <memory>
 #include <condition_variable>
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <rex/task.hpp>
 
 namespace rex
 {
+    struct QueuedTask
+    {
+        Task task;
+        uint64_t id;
+        //the task that was running on the worker that queued this one, or 0 if it was queued from outside of the pool
+        uint64_t parent;
+    };
+
     class TaskComparer
     {
         public:
-            bool operator() (const std::pair<int32_t, std::function<void()>>& a, const std::pair<int32_t, std::function<void()>>& b)
+            bool operator() (const std::pair<int32_t, QueuedTask>& a, const std::pair<int32_t, QueuedTask>& b)
             {
                 return a.first > b.first;
             }
     };
-    
+
+    //every worker owns a deque that it takes work from and that idle workers steal from. tasks with a priority other than 0 go in a shared, ordered lane instead. negative priorities are run before anything in the deques and positive ones after
     class ThreadPool {
     public:
         ThreadPool(size_t threadCount);
         template<class Task, class... Args>
         std::future<typename std::result_of<Task(Args...)>::type> enqueue(Task&& task, int32_t priority = 0, Args&&... args);
+        //waits for a future. on a worker of this pool, the tasks that the running task queued itself are run meanwhile, so a task that waits on its own work never stalls the pool. other tasks are left alone, since they may wait on something further down the stack of the worker
+        template<class Future>
+        void wait(const Future& future);
+        //the same, but gives up after the timeout, so that the caller can look for other ways to get what it waits for
+        template<class Future, class Rep, class Period>
+        std::future_status waitFor(const Future& future, const std::chrono::duration<Rep, Period>& timeout);
         std::vector<std::thread::id> getThreadIds();
+        size_t threadCount() const;
         ~ThreadPool();
     private:
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            TaskRing<QueuedTask> tasks;
+        };
+
+        //runs the function into the promise of the future that enqueue gave
+        template <typename ReturnType, typename Function>
+        struct PromisedTask
+        {
+            void operator()();
+            std::promise<ReturnType> promise;
+            Function function;
+        };
+
+        template <typename Function>
+        static void fulfil(std::promise<void>& promise, Function& function);
+        template <typename ReturnType, typename Function>
+        static void fulfil(std::promise<ReturnType>& promise, Function& function);
+
+        struct WorkerIdentity
+        {
+            const ThreadPool* pool;
+            size_t index;
+            //the innermost task running on the worker
+            uint64_t task;
+        };
+
+        void push(Task task, int32_t priority);
+        bool popPriorityTask(QueuedTask& task, bool urgentOnly);
+        bool popTask(size_t workerIndex, QueuedTask& task);
+        //takes a task that the given one queued, if it is still waiting
+        bool popChild(size_t workerIndex, uint64_t parent, QueuedTask& task);
+        void run(QueuedTask& task);
+        void work(size_t workerIndex);
+        static WorkerIdentity& currentWorker();
+
         std::vector<std::thread> mWorkers;
-        std::priority_queue<std::pair<int32_t, std::function<void()>>, 
-                            std::vector<std::pair<int32_t, std::function<void()>>>,
-                            TaskComparer> mTasks;
-        
+        std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+        //a heap rather than a priority_queue, so that a waiting worker can take its own tasks out of the middle
+        std::vector<std::pair<int32_t, QueuedTask>> mPriorityTasks;
+        std::mutex mPriorityMutex;
+        std::atomic<size_t> mPriorityCount;
+        std::atomic<size_t> mUrgentCount;
+        std::atomic<size_t> mPendingCount;
+        std::atomic<size_t> mNextQueue;
+        std::atomic<uint64_t> mNextId;
+
         // synchronization
-        std::mutex mQueueMutex;
+        std::mutex mSleepMutex;
         std::condition_variable mCondition;
-        bool mStop;
+        std::atomic<size_t> mSleepingCount;
+        std::atomic<bool> mStop;
     };
-     
+
     inline ThreadPool::ThreadPool(size_t threadCount) :
+        mPriorityCount(0),
+        mUrgentCount(0),
+        mPendingCount(0),
+        mNextQueue(0),
+        mNextId(1),
+        mSleepingCount(0),
         mStop(false)
     {
+        for(size_t i = 0; i < std::max<size_t>(threadCount, 1); ++i)
+            mQueues.emplace_back(new WorkerQueue());
+
         for(size_t i = 0; i < threadCount; ++i)
         {
             mWorkers.emplace_back(
-                [this]
+                [this, i]
                 {
-                    for(;;)
-                    {
-                        std::unique_lock<std::mutex> lock(mQueueMutex);
-
-                        while(!mStop && mTasks.empty())
-                            mCondition.wait(lock);
-
-                        if(mStop && mTasks.empty())
-                            return;
-
-                        std::function<void()> task(mTasks.top().second);
-                        mTasks.pop();
-                        lock.unlock();
-                        task();
-                    }
+                    work(i);
                 }
             );
         }
     }
-    
+
     inline std::vector<std::thread::id> ThreadPool::getThreadIds()
     {
-        std::lock_guard<std::mutex> lock(mQueueMutex);
         std::vector<std::thread::id> result;
-    
+
         for(const auto& thread : mWorkers)
             result.push_back(thread.get_id());
-    
+
         return result;
     }
-    
+
+    inline size_t ThreadPool::threadCount() const
+    {
+        return mWorkers.size();
+    }
+
     template<class Task, class... Args>
-    std::future<typename std::result_of<Task(Args...)>::type> ThreadPool::enqueue(Task&& task, int32_t priority, Args&&... args) 
+    std::future<typename std::result_of<Task(Args...)>::type> ThreadPool::enqueue(Task&& task, int32_t priority, Args&&... args)
     {
         using ReturnType = typename std::result_of<Task(Args...)>::type;
-        
+
         if(mStop)
             throw std::runtime_error("enqueue on stopped ThreadPool");
-    
-        auto packagedTask = std::make_shared<std::packaged_task<ReturnType()>>(
-                std::bind(std::forward<Task>(task), std::forward<Args>(args)...)
-            );
-            
-        std::future<ReturnType> result = packagedTask->get_future();
+
+        using Function = decltype(std::bind(std::forward<Task>(task), std::forward<Args>(args)...));
+
+        //the state shared with the future comes from TaskMemory, and the task keeps the function in place, so nothing here allocates once warmed up
+        std::promise<ReturnType> promise(std::allocator_arg, TaskAllocator<ReturnType>());
+        std::future<ReturnType> result = promise.get_future();
+        push(rex::Task(PromisedTask<ReturnType, Function>{std::move(promise), std::bind(std::forward<Task>(task), std::forward<Args>(args)...)}), priority);
+        return result;
+    }
+
+    template <typename ReturnType, typename Function>
+    void ThreadPool::PromisedTask<ReturnType, Function>::operator()()
+    {
+        try
         {
-            std::unique_lock<std::mutex> lock(mQueueMutex);
-            mTasks.push({priority, [packagedTask](){ (*packagedTask)(); }});
+            fulfil(promise, function);
+        }
+        catch(...)
+        {
+            promise.set_exception(std::current_exception());
         }
-        mCondition.notify_one();
-        return result;
     }
-    
+
+    template <typename Function>
+    void ThreadPool::fulfil(std::promise<void>& promise, Function& function)
+    {
+        function();
+        promise.set_value();
+    }
+
+    template <typename ReturnType, typename Function>
+    void ThreadPool::fulfil(std::promise<ReturnType>& promise, Function& function)
+    {
+        promise.set_value(function());
+    }
+
+    template<class Future>
+    void ThreadPool::wait(const Future& future)
+    {
+        const WorkerIdentity& current = currentWorker();
+
+        if(current.pool != this)
+        {
+            future.wait();
+            return;
+        }
+
+        while(waitFor(future, std::chrono::seconds(1)) != std::future_status::ready)
+        {
+        }
+    }
+
+    template<class Future, class Rep, class Period>
+    std::future_status ThreadPool::waitFor(const Future& future, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        const WorkerIdentity& current = currentWorker();
+
+        if(current.pool != this)
+            return future.wait_for(timeout);
+
+        uint64_t waiting = current.task;
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if(std::chrono::steady_clock::now() >= deadline)
+                return std::future_status::timeout;
+
+            QueuedTask task;
+
+            if(popChild(current.index, waiting, task))
+            {
+                --mPendingCount;
+                run(task);
+            }
+            else
+            {//what we wait for runs on another worker, or is yet to be queued by the running task through something it waits on
+                future.wait_for(std::chrono::microseconds(100));
+            }
+        }
+
+        return std::future_status::ready;
+    }
+
     inline ThreadPool::~ThreadPool()
     {
         {
-            std::unique_lock<std::mutex> lock(mQueueMutex);
+            std::unique_lock<std::mutex> lock(mSleepMutex);
             mStop = true;
         }
 
@@ -110,4 +246,185 @@ namespace rex
         for(size_t i = 0; i < mWorkers.size(); ++i)
             mWorkers[i].join();
     }
+
+    inline void ThreadPool::push(Task task, int32_t priority)
+    {
+        const WorkerIdentity& current = currentWorker();
+        QueuedTask queued{std::move(task), mNextId.fetch_add(1, std::memory_order_relaxed), current.pool == this ? current.task : 0};
+
+        if(priority != 0)
+        {
+            std::lock_guard<std::mutex> lock(mPriorityMutex);
+            mPriorityTasks.emplace_back(priority, std::move(queued));
+            std::push_heap(mPriorityTasks.begin(), mPriorityTasks.end(), TaskComparer());
+
+            if(priority < 0)
+                ++mUrgentCount;
+            ++mPriorityCount;
+        }
+        else
+        {
+            //work spawned from a worker stays with that worker unless stolen, everything else is spread out
+            size_t queueIndex = current.pool == this ? current.index : mNextQueue.fetch_add(1, std::memory_order_relaxed) % mQueues.size();
+            WorkerQueue& queue = *mQueues[queueIndex];
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.pushBack(std::move(queued));
+        }
+
+        ++mPendingCount;
+
+        //sleeping workers check the pending count under the sleep lock, so taking it here makes sure the notification is not lost
+        if(mSleepingCount > 0)
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mCondition.notify_one();
+        }
+    }
+
+    inline bool ThreadPool::popPriorityTask(QueuedTask& task, bool urgentOnly)
+    {
+        if((urgentOnly ? mUrgentCount : mPriorityCount).load(std::memory_order_relaxed) == 0)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mPriorityMutex);
+
+        if(mPriorityTasks.empty() || (urgentOnly && mPriorityTasks.front().first >= 0))
+            return false;
+
+        if(mPriorityTasks.front().first < 0)
+            --mUrgentCount;
+        --mPriorityCount;
+
+        std::pop_heap(mPriorityTasks.begin(), mPriorityTasks.end(), TaskComparer());
+        task = std::move(mPriorityTasks.back().second);
+        mPriorityTasks.pop_back();
+        return true;
+    }
+
+    inline bool ThreadPool::popChild(size_t workerIndex, uint64_t parent, QueuedTask& task)
+    {
+        if(parent == 0 || mPendingCount.load(std::memory_order_relaxed) == 0)
+            return false;
+
+        {//tasks queued from a worker go to its own queue, so the children are there unless stolen. the newest is taken first, as it is the most likely to be waited on
+            WorkerQueue& own = *mQueues[workerIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+
+            for(size_t index = own.tasks.size(); index > 0; --index)
+            {
+                if(own.tasks[index - 1].parent == parent)
+                {
+                    task = own.tasks.take(index - 1);
+                    return true;
+                }
+            }
+        }
+
+        if(mPriorityCount.load(std::memory_order_relaxed) == 0)
+            return false;
+
+        std::lock_guard<std::mutex> lock(mPriorityMutex);
+        size_t best = mPriorityTasks.size();
+
+        for(size_t index = 0; index < mPriorityTasks.size(); ++index)
+        {
+            if(mPriorityTasks[index].second.parent == parent && (best == mPriorityTasks.size() || mPriorityTasks[index].first < mPriorityTasks[best].first))
+                best = index;
+        }
+
+        if(best == mPriorityTasks.size())
+            return false;
+
+        if(mPriorityTasks[best].first < 0)
+            --mUrgentCount;
+        --mPriorityCount;
+
+        task = std::move(mPriorityTasks[best].second);
+        mPriorityTasks[best] = std::move(mPriorityTasks.back());
+        mPriorityTasks.pop_back();
+        std::make_heap(mPriorityTasks.begin(), mPriorityTasks.end(), TaskComparer());
+        return true;
+    }
+
+    inline void ThreadPool::run(QueuedTask& task)
+    {
+        WorkerIdentity& current = currentWorker();
+        uint64_t outer = current.task;
+
+        //tasks only ever run as PromisedTask, which keeps exceptions in the future, so this is always put back
+        current.task = task.id;
+        task.task();
+        current.task = outer;
+    }
+
+    inline bool ThreadPool::popTask(size_t workerIndex, QueuedTask& task)
+    {
+        if(mPendingCount.load(std::memory_order_relaxed) == 0)
+            return false;
+
+        if(popPriorityTask(task, true))
+            return true;
+
+        {
+            WorkerQueue& own = *mQueues[workerIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+
+            if(!own.tasks.empty())
+            {
+                task = own.tasks.popFront();
+                return true;
+            }
+        }
+
+        for(size_t offset = 1; offset < mQueues.size(); ++offset)
+        {
+            WorkerQueue& victim = *mQueues[(workerIndex + offset) % mQueues.size()];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+
+            if(lock.owns_lock() && !victim.tasks.empty())
+            {
+                task = victim.tasks.popBack();
+                return true;
+            }
+        }
+
+        return popPriorityTask(task, false);
+    }
+
+    inline void ThreadPool::work(size_t workerIndex)
+    {
+        currentWorker() = WorkerIdentity{this, workerIndex, 0};
+
+        for(;;)
+        {
+            QueuedTask task;
+
+            if(popTask(workerIndex, task))
+            {
+                --mPendingCount;
+                run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+
+            if(mStop && mPendingCount == 0)
+                return;
+
+            //a failed try_lock while stealing can leave work behind, so only sleep when nothing is pending at all
+            if(mPendingCount > 0)
+                continue;
+
+            ++mSleepingCount;
+            mCondition.wait(lock, [this] { return mStop || mPendingCount > 0; });
+            --mSleepingCount;
+        }
+    }
+
+    inline ThreadPool::WorkerIdentity& ThreadPool::currentWorker()
+    {
+        static thread_local WorkerIdentity identity{nullptr, 0, 0};
+        return identity;
+    }
 }
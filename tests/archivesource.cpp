@@ -0,0 +1,131 @@
+#include <catch.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <rex/resourceprovider.hpp>
+#include "helpers/textarchivesource.hpp"
+
+namespace
+{
+    std::string readFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+}
+
+SCENARIO("Archives bundle assets in a single file that an archive source can serve")
+{
+    GIVEN("an archive packed from a folder of resources")
+    {
+        std::string archivePath = "rex_test_trees.rxa";
+
+        rex::ArchiveWriter writer;
+        writer.addFolder("tests/data/trees");
+        writer.add("extra", "some data");
+        writer.add("empty", "");
+        writer.write(archivePath);
+
+        WHEN("an archive source lists the archive")
+        {
+            TextArchiveSource source(archivePath);
+            auto ids = source.list();
+
+            THEN("every packed asset is listed by the name a file source would give it")
+            {
+                REQUIRE(ids.size() == 1002);
+
+                std::set<std::string> idSet(ids.begin(), ids.end());
+
+                for(int32_t i = 0; i < 1000; ++i)
+                    CHECK(idSet.count("tree" + std::to_string(i)) != 0);
+
+                CHECK(idSet.count("extra") != 0);
+                CHECK(idSet.count("empty") != 0);
+            }
+        }
+
+        WHEN("assets are loaded from the archive source")
+        {
+            TextArchiveSource source(archivePath);
+
+            THEN("they have the exact contents that were packed")
+            {
+                CHECK(source.load("tree1") == readFile("tests/data/trees/tree1.json"));
+                CHECK(source.load("tree999") == readFile("tests/data/trees/tree999.json"));
+                CHECK(source.load("extra") == "some data");
+                CHECK(source.load("empty").empty());
+            }
+
+            THEN("loading an id that is not in the archive throws")
+            {
+                CHECK_THROWS_AS(source.load("asdf"), rex::InvalidResourceException);
+            }
+        }
+
+        WHEN("the archive source is added to a resource provider")
+        {
+            rex::ResourceProvider provider;
+            provider.addSource("trees", TextArchiveSource(archivePath));
+
+            THEN("resources are accessed from it like from any other source")
+            {
+                CHECK(provider.list("trees").size() == 1002);
+                CHECK(provider.get<std::string>("trees", "tree2") == readFile("tests/data/trees/tree2.json"));
+            }
+        }
+
+        WHEN("the data in the archive is damaged")
+        {
+            {
+                TextArchiveSource source(archivePath);
+                CHECK(source.load("extra") == "some data");
+            }
+
+            std::string contents = readFile(archivePath);
+            size_t position = contents.find("some data");
+            REQUIRE(position != std::string::npos);
+            contents[position] = 'S';
+            std::ofstream(archivePath, std::ios::binary | std::ios::trunc) << contents;
+
+            TextArchiveSource source(archivePath);
+
+            THEN("loading the damaged asset throws, unless checksums are not verified")
+            {
+                CHECK_THROWS_AS(source.load("extra"), rex::InvalidResourceException);
+                CHECK(source.load("tree1") == readFile("tests/data/trees/tree1.json"));
+                CHECK(TextArchiveSource(archivePath, false).load("extra") == "Some data");
+            }
+        }
+
+        std::remove(archivePath.c_str());
+    }
+
+    GIVEN("an archive writer")
+    {
+        rex::ArchiveWriter writer;
+        writer.add("a", "1");
+
+        WHEN("an id is added twice")
+        {
+            THEN("an exception is thrown")
+            {
+                CHECK_THROWS_AS(writer.add("a", "2"), rex::AmbiguousNameException);
+            }
+        }
+    }
+
+    GIVEN("files that are not archives")
+    {
+        WHEN("an archive source is set up with them")
+        {
+            THEN("an exception is thrown")
+            {
+                CHECK_THROWS_AS(TextArchiveSource("tests/data/trees/tree1.json"), rex::InvalidFileException);
+                CHECK_THROWS_AS(TextArchiveSource("tests/data/unique/1/a.txt"), rex::InvalidFileException);
+                CHECK_THROWS_AS(TextArchiveSource("tests/data/nonexistent.rxa"), rex::InvalidFileException);
+            }
+        }
+    }
+}
@@ -113,3 +113,58 @@ SCENARIO("File listers can be used to list all files and folders in a folder rec
         }
     }
 }
+
+SCENARIO("File listers can stream the entries they find instead of collecting them")
+{
+    GIVEN("a file lister with a given directory path with ALL mode")
+    {
+        rex::FileLister fileLister(std::string("tests/data/folders"), rex::FileLister::ALL);
+
+        WHEN("the lister is iterated over")
+        {
+            std::vector<std::string> streamed;
+
+            fileLister.forEach([&streamed] (const std::string& path)
+            {
+                streamed.push_back(path);
+            });
+
+            THEN("it gives the same entries as listing does")
+            {
+                std::vector<rex::Path> fileList = fileLister.list();
+
+                REQUIRE(streamed.size() == 14);
+                CHECK(std::set<std::string>(streamed.begin(), streamed.end()) == std::set<std::string>(fileList.begin(), fileList.end()));
+            }
+        }
+    }
+}
+
+#ifndef REX_DISABLE_ASYNC
+SCENARIO("File listers can scan folders in parallel on a thread pool")
+{
+    GIVEN("a thread pool and file listers in every mode")
+    {
+        rex::ThreadPool pool(4);
+
+        WHEN("the folders are listed on the pool")
+        {
+            THEN("the result is the same as when listing them on one thread")
+            {
+                for(auto mode : {rex::FileLister::FILES, rex::FileLister::FOLDERS, rex::FileLister::ALL})
+                {
+                    rex::FileLister fileLister(std::string("tests/data/folders"), mode);
+
+                    std::vector<rex::Path> sequential = fileLister.list();
+                    std::vector<rex::Path> parallel = fileLister.list(pool);
+
+                    CHECK(parallel.size() == sequential.size());
+                    CHECK(std::set<std::string>(parallel.begin(), parallel.end()) == std::set<std::string>(sequential.begin(), sequential.end()));
+                }
+
+                CHECK(rex::FileLister(std::string("tests/data/trees"), rex::FileLister::FILES).list(pool).size() == 1000);
+            }
+        }
+    }
+}
+#endif
@@ -1,5 +1,10 @@
 #include <catch.hpp>
+#include "helpers/textfilesource.hpp"
 #include "helpers/treefilesource.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 
 SCENARIO("File sources set to a folder with a regex will find files recursively with the regex as a filter")
 {
@@ -167,3 +172,105 @@ SCENARIO("a file source can be used to access the resources it represents")
         }
     }
 }
+
+SCENARIO("a mapped file source hands the loader the contents of files straight from memory")
+{
+    GIVEN("a mapped file source setup to a directory with resources")
+    {
+        TextFileSource textSource("tests/data/trees");
+
+        WHEN("existing resources are accessed")
+        {
+            std::string text = textSource.load("tree1");
+
+            THEN("the loader gets exactly the contents of the file")
+            {
+                std::ifstream file("tests/data/trees/tree1.json", std::ios::binary);
+                std::string expected((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+                CHECK(text == expected);
+            }
+        }
+    }
+
+    GIVEN("a mapped file source setup to a directory with empty files")
+    {
+        TextFileSource textSource("tests/data/unique");
+
+        WHEN("an empty file is accessed")
+        {
+            THEN("the loader gets nothing to decode")
+            {
+                CHECK(textSource.load("a").empty());
+            }
+        }
+    }
+}
+
+SCENARIO("a file source can keep what it found in a manifest to skip scanning on later runs")
+{
+    GIVEN("a manifest path and a folder with resources")
+    {
+        std::string manifestPath = "rex_test_manifest.rxm";
+        std::remove(manifestPath.c_str());
+
+        WHEN("file sources are set up with the manifest")
+        {
+            TreeFileSource first("tests/data/trees", ".*5\\d\\d.*", rex::Naming::NO_EXT, manifestPath);
+            TreeFileSource second("tests/data/trees", ".*5\\d\\d.*", rex::Naming::NO_EXT, manifestPath);
+
+            THEN("they find the same resources as one without a manifest")
+            {
+                auto expected = TreeFileSource("tests/data/trees", std::regex(".*5\\d\\d.*")).list();
+                auto firstList = first.list();
+                auto secondList = second.list();
+
+                REQUIRE(firstList.size() == 100);
+                CHECK(std::set<std::string>(firstList.begin(), firstList.end()) == std::set<std::string>(expected.begin(), expected.end()));
+                CHECK(std::set<std::string>(secondList.begin(), secondList.end()) == std::set<std::string>(expected.begin(), expected.end()));
+                CHECK(second.load("tree512").barkType == first.load("tree512").barkType);
+            }
+        }
+
+        WHEN("a manifest exists for the same folder, pattern and naming and the folders are unmodified")
+        {
+            std::string key = std::string("tests/data/unique") + '\n' + rex::Filter(".*").description() + '\n' + std::to_string(static_cast<int32_t>(rex::Naming::NO_EXT));
+            rex::FileManifest::FolderStamps folders{{"tests/data/unique", rex::FileManifest::folderStamp("tests/data/unique")}};
+            rex::FileManifest::write(manifestPath, key, folders, {{"remembered", rex::Path("tests/data/unique/1/a.txt")}});
+
+            THEN("the resources are taken from the manifest without scanning")
+            {
+                TextFileSource source("tests/data/unique", ".*", rex::Naming::NO_EXT, manifestPath);
+
+                CHECK(source.list() == std::vector<std::string>{"remembered"});
+            }
+
+            THEN("a source with another pattern or naming scans instead")
+            {
+                CHECK(TextFileSource("tests/data/unique", ".*\\.txt", rex::Naming::NO_EXT, manifestPath).list().size() == 6);
+                CHECK(TextFileSource("tests/data/unique", ".*", rex::Naming::FILE_NAME, manifestPath).list().size() == 6);
+            }
+        }
+
+        WHEN("a file is added to one of the folders after the manifest was written")
+        {
+            TextFileSource("tests/data/unique", ".*", rex::Naming::NO_EXT, manifestPath);
+
+            std::string addedPath = "tests/data/unique/1/added.txt";
+            std::ofstream(addedPath) << "new";
+
+            TextFileSource source("tests/data/unique", ".*", rex::Naming::NO_EXT, manifestPath);
+            std::remove(addedPath.c_str());
+
+            THEN("the manifest is no longer trusted and the folder is scanned again")
+            {
+                auto ids = source.list();
+
+                CHECK(ids.size() == 7);
+                CHECK(std::count(ids.begin(), ids.end(), "added") == 1);
+            }
+        }
+
+        std::remove(manifestPath.c_str());
+    }
+}
@@ -0,0 +1,137 @@
+#include <catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <rex/filewatcher.hpp>
+#include "helpers/tempfolder.hpp"
+
+namespace
+{
+    class ChangeLog
+    {
+        public:
+            void add(const std::string& path)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mPaths.insert(path);
+            }
+
+            bool has(const std::string& path)
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                return mPaths.count(path) != 0;
+            }
+
+            //waits a while for the path to show up
+            bool saw(const std::string& path)
+            {
+                for(int32_t i = 0; i < 500 && !has(path); ++i)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+                return has(path);
+            }
+
+            bool sawAny()
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                return !mPaths.empty();
+            }
+        private:
+            std::mutex mMutex;
+            std::set<std::string> mPaths;
+    };
+
+    //writes and replaces watched files, and leaves one alone
+    void checkChanges(rex::FileWatcher::Backend backend)
+    {
+        TempFolder folder;
+        REQUIRE_FALSE(folder.path().empty());
+
+        std::string writtenPath = folder.file("written.txt");
+        std::string replacedPath = folder.file("replaced.txt");
+        std::string swapPath = folder.file("replaced.txt.tmp");
+        std::string untouchedPath = folder.file("untouched.txt");
+        std::ofstream(writtenPath) << "old";
+        std::ofstream(replacedPath) << "old";
+        std::ofstream(untouchedPath) << "old";
+
+        ChangeLog changes;
+
+        {
+            rex::FileWatcher watcher([&changes] (const std::string& path)
+            {
+                changes.add(path);
+            }, std::chrono::milliseconds(20), backend);
+
+            watcher.watch(writtenPath);
+            watcher.watch(replacedPath);
+            watcher.watch(untouchedPath);
+
+            //modification times may be coarse, so the polling watcher has to see the old ones first
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            std::ofstream(writtenPath) << "new";
+            std::ofstream(swapPath) << "new";
+            std::rename(swapPath.c_str(), replacedPath.c_str());
+
+            CHECK(changes.saw(writtenPath));
+            CHECK(changes.saw(replacedPath));
+        }
+
+        CHECK_FALSE(changes.has(untouchedPath));
+    }
+}
+
+SCENARIO("FileWatcher tells when the files it watches are written or replaced")
+{
+    GIVEN("a file watcher that uses inotify")
+    {
+        WHEN("watched files are written and replaced")
+        {
+            THEN("each of them is told about")
+            {
+                checkChanges(rex::FileWatcher::Backend::INOTIFY);
+            }
+        }
+    }
+
+    GIVEN("a file watcher that polls modification times")
+    {
+        WHEN("watched files are written and replaced")
+        {
+            THEN("each of them is told about, the same as with inotify")
+            {
+                checkChanges(rex::FileWatcher::Backend::POLLING);
+            }
+        }
+    }
+
+    GIVEN("a file watcher with nothing changing")
+    {
+        TempFolder folder;
+        REQUIRE_FALSE(folder.path().empty());
+
+        std::string untouchedPath = folder.file("untouched.txt");
+        std::ofstream(untouchedPath) << "old";
+
+        ChangeLog changes;
+
+        {
+            rex::FileWatcher watcher([&changes] (const std::string& path)
+            {
+                changes.add(path);
+            }, std::chrono::milliseconds(20));
+
+            watcher.watch(untouchedPath);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        THEN("nothing is told about")
+        {
+            CHECK_FALSE(changes.sawAny());
+        }
+    }
+}
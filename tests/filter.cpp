@@ -0,0 +1,115 @@
+#include <catch.hpp>
+#include <rex/filter.hpp>
+#include "helpers/treefilesource.hpp"
+
+SCENARIO("Filters can match paths by extension, glob, prefix or regex")
+{
+    GIVEN("a default filter")
+    {
+        rex::Filter filter;
+
+        THEN("it matches everything")
+        {
+            CHECK(filter.matches("tests/data/trees/tree1.json"));
+            CHECK(filter.matches(""));
+        }
+    }
+
+    GIVEN("an extension filter")
+    {
+        rex::Filter filter = rex::Filter::extensions({"png", "json"});
+
+        THEN("it matches paths ending with any of the extensions")
+        {
+            CHECK(filter.matches("tests/data/trees/tree1.json"));
+            CHECK(filter.matches("image.png"));
+            CHECK(filter.matches("archive.tar.png"));
+            CHECK_FALSE(filter.matches("image.pngx"));
+            CHECK_FALSE(filter.matches("image.jpg"));
+            CHECK_FALSE(filter.matches("folder.png/file"));
+            CHECK_FALSE(filter.matches("png"));
+        }
+    }
+
+    GIVEN("a glob filter without slashes")
+    {
+        rex::Filter filter = rex::Filter::glob("tree?.json");
+
+        THEN("it is matched against the file name only")
+        {
+            CHECK(filter.matches("tests/data/trees/tree1.json"));
+            CHECK(filter.matches("tree9.json"));
+            CHECK_FALSE(filter.matches("tests/data/trees/tree10.json"));
+            CHECK_FALSE(filter.matches("tests/data/trees/tree1.jsonx"));
+        }
+    }
+
+    GIVEN("glob filters with slashes")
+    {
+        rex::Filter single = rex::Filter::glob("tests/*/tree*.json");
+        rex::Filter recursive = rex::Filter::glob("tests/**/tree*.json");
+
+        THEN("'*' doesn't match across folders while '**' does")
+        {
+            CHECK_FALSE(single.matches("tests/data/trees/tree1.json"));
+            CHECK(single.matches("tests/trees/tree1.json"));
+            CHECK(recursive.matches("tests/data/trees/tree1.json"));
+            CHECK(recursive.matches("tests/trees/tree123.json"));
+            CHECK_FALSE(recursive.matches("other/data/trees/tree1.json"));
+            CHECK_FALSE(recursive.matches("tests/data/trees/tree1.json/other"));
+        }
+    }
+
+    GIVEN("a prefix filter")
+    {
+        rex::Filter filter = rex::Filter::prefixes({"tests/data/trees/tree5", "tests/data/people/", "tests/data/trees/tree59"});
+
+        THEN("it matches paths starting with any of the prefixes")
+        {
+            CHECK(filter.matches("tests/data/trees/tree5.json"));
+            CHECK(filter.matches("tests/data/trees/tree512.json"));
+            CHECK(filter.matches("tests/data/people/anders"));
+            CHECK_FALSE(filter.matches("tests/data/trees/tree6.json"));
+            CHECK_FALSE(filter.matches("tests/data/people"));
+        }
+    }
+
+    GIVEN("regex patterns of the common shapes and others")
+    {
+        THEN("they match the same as std::regex does")
+        {
+            std::vector<std::string> patterns{".*", ".*\\.json", ".*\\.(json|txt)", "tests/data/trees/tree5.*", ".*5\\d\\d.*", "[a-z]+"};
+            std::vector<std::string> paths{"tests/data/trees/tree1.json", "tests/data/trees/tree512.json", "tests/data/unique/1/a.txt", "tests/data/folders/file1", "abc", "x.json.bak"};
+
+            for(const auto& pattern : patterns)
+            {
+                rex::Filter filter(pattern);
+                std::regex regex(pattern);
+
+                for(const auto& path : paths)
+                    CHECK(filter.matches(path) == std::regex_match(path, regex));
+            }
+        }
+
+        THEN("they are described by their pattern, unlike filters made from std::regex objects")
+        {
+            CHECK(rex::Filter(".*\\.json").description() == "regex:.*\\.json");
+            CHECK(rex::Filter(std::regex(".*")).description().empty());
+        }
+    }
+}
+
+SCENARIO("File sources can be set up with filters")
+{
+    GIVEN("file sources with an extension and a glob filter")
+    {
+        TreeFileSource byExtension("tests/data/trees", rex::Filter::extensions({"json"}));
+        TreeFileSource byGlob("tests/data/trees", rex::Filter::glob("tree5??.json"));
+
+        THEN("they only find the matching files")
+        {
+            CHECK(byExtension.list().size() == 1000);
+            CHECK(byGlob.list().size() == 100);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+//a folder of its own under the temporary folder of the system, for tests that write the files they look at. it is removed together with the files it gave out
+class TempFolder
+{
+    public:
+        TempFolder()
+        {
+#ifdef _WIN32
+            const char* root = std::getenv("TEMP");
+            std::string pattern = std::string(root ? root : ".") + "\\rexXXXXXX";
+
+            if(_mktemp_s(&pattern[0], pattern.size() + 1) == 0 && _mkdir(pattern.c_str()) == 0)
+                mPath = pattern;
+#else
+            const char* root = std::getenv("TMPDIR");
+            std::string pattern = std::string(root ? root : "/tmp") + "/rexXXXXXX";
+
+            if(mkdtemp(&pattern[0]))
+                mPath = pattern;
+#endif
+        }
+
+        TempFolder(const TempFolder& other) = delete;
+        TempFolder& operator=(const TempFolder& other) = delete;
+
+        ~TempFolder()
+        {
+            if(mPath.empty())
+                return;
+
+            for(const std::string& file : mFiles)
+                std::remove(file.c_str());
+
+#ifdef _WIN32
+            _rmdir(mPath.c_str());
+#else
+            rmdir(mPath.c_str());
+#endif
+        }
+
+        //empty if the folder couldn't be made
+        const std::string& path() const
+        {
+            return mPath;
+        }
+
+        //the path of a file in the folder, which is removed with it
+        std::string file(const std::string& name)
+        {
+            mFiles.push_back(mPath + "/" + name);
+            return mFiles.back();
+        }
+    private:
+        std::string mPath;
+        std::vector<std::string> mFiles;
+};
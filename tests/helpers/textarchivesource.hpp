@@ -0,0 +1,17 @@
+#pragma once
+#include <rex/archivesource.hpp>
+#include <string>
+
+class TextArchiveSource : public rex::ArchiveSource<std::string>
+{
+    public:
+        using rex::ArchiveSource<std::string>::ArchiveSource;
+
+        std::string loadFromMemory(const char* data, size_t size) const override
+        {
+            if(size == 0)
+                return std::string();
+
+            return std::string(data, size);
+        }
+};
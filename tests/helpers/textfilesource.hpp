@@ -0,0 +1,17 @@
+#pragma once
+#include <rex/mappedfilesource.hpp>
+#include <string>
+
+class TextFileSource : public rex::MappedFileSource<std::string>
+{
+    public:
+        using rex::MappedFileSource<std::string>::MappedFileSource;
+
+        std::string loadFromMemory(const char* data, size_t size) const override
+        {
+            if(size == 0)
+                return std::string();
+
+            return std::string(data, size);
+        }
+};
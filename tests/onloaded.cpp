@@ -87,6 +87,35 @@ SCENARIO("OnLoaded can be used to make callback functions execute on successfull
                 CHECK(loadedTreeIds.count(3) != 0);
             }
         }
+
+        WHEN("an OnLoaded is created after the loads finished, together with a view that doesn't come from the ResourceProvider")
+        {
+            std::vector<rex::AsyncResourceView<Tree>> asyncResources = provider.asyncGet<Tree>("trees", std::vector<std::string>{"tree4", "tree5"});
+
+            for(const auto& asyncResource : asyncResources)
+                asyncResource.future.wait();
+
+            Tree custom = provider.get<Tree>("trees", "tree6");
+            std::promise<const Tree&> customLoad;
+            asyncResources.push_back(rex::AsyncResourceView<Tree>{"tree7", customLoad.get_future().share(), rex::ResourceHandle<Tree>()});
+
+            std::multiset<std::string> loadedTrees;
+            rex::OnLoaded onLoaded(asyncResources, [&loadedTrees] (const std::string& identifier, const Tree& loadedResource)
+            {
+                loadedTrees.emplace(identifier);
+            });
+
+            THEN("the callback is run once for each of them as soon as they are done")
+            {
+                onLoaded.poll();
+                CHECK(loadedTrees == std::multiset<std::string>({"tree4", "tree5"}));
+
+                customLoad.set_value(custom);
+                onLoaded.poll();
+                onLoaded.poll();
+                CHECK(loadedTrees == std::multiset<std::string>({"tree4", "tree5", "tree7"}));
+            }
+        }
     }
 }
 #endif
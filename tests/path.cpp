@@ -212,3 +212,37 @@ SCENARIO("Paths represent a file path")
         }
     }
 }
+
+SCENARIO("Path components are views into the path itself")
+{
+    GIVEN("A path with backslashes")
+    {
+        rex::Path path("data\\folder\\\\sub\\file.tar.ext");
+
+        WHEN("path data is accessed without converting it")
+        {
+            THEN("every backslash is turned into a frontslash and the components compare directly")
+            {
+                CHECK(path.str() == "data/folder//sub/file.tar.ext");
+                CHECK(path.fileName() == "file.tar.ext");
+                CHECK(path.stem() == "file.tar");
+                CHECK(path.extension() == "ext");
+                CHECK(path.fileName().data() == path.str().data() + path.str().size() - path.fileName().size());
+            }
+        }
+
+        WHEN("the path is copied and the original is gone")
+        {
+            rex::Path* original = new rex::Path(path);
+            rex::Path copy = *original;
+            delete original;
+
+            THEN("the components of the copy still refer to the copy")
+            {
+                CHECK(copy.fileName() == "file.tar.ext");
+                CHECK(copy.stem() == "file.tar");
+                CHECK(copy.extension() == "ext");
+            }
+        }
+    }
+}
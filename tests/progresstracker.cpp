@@ -123,6 +123,34 @@ SCENARIO("ProgressTracker can tell the current progress of an async loading proc
                 CHECK(lastFailedRatio == Approx(0.5f));
             }
         }
+
+        WHEN("a ProgressTracker is created after some loads finished, together with a view that doesn't come from the ResourceProvider")
+        {
+            std::vector<rex::AsyncResourceView<Tree>> asyncResources = provider.asyncGet<Tree>("trees", std::vector<std::string>{"tree5", "blah"});
+
+            for(const auto& asyncResource : asyncResources)
+                asyncResource.future.wait();
+
+            Tree custom = provider.get<Tree>("trees", "tree6");
+            std::promise<const Tree&> customLoad;
+            asyncResources.push_back(rex::AsyncResourceView<Tree>{"tree7", customLoad.get_future().share(), rex::ResourceHandle<Tree>()});
+
+            rex::ProgressTracker tracker(asyncResources);
+
+            THEN("the finished ones are counted right away and the other one once it is done")
+            {
+                rex::ProgressTracker::Status status = tracker.status();
+                CHECK(status.done() == 1);
+                CHECK(status.failed() == 1);
+                CHECK(status.waiting() == 1);
+
+                customLoad.set_value(custom);
+                status = tracker.status();
+                CHECK(status.done() == 2);
+                CHECK(status.failed() == 1);
+                CHECK(status.waiting() == 0);
+            }
+        }
     }
 }
 #endif
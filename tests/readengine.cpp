@@ -0,0 +1,143 @@
+#include <catch.hpp>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <rex/readengine.hpp>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    std::string fileContents(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    //reads many files, an empty file and a missing file at once
+    void checkReads(rex::ReadEngine& engine)
+    {
+        std::vector<std::string> paths;
+
+        for(int32_t i = 0; i < 40; ++i)
+            paths.push_back("tests/data/trees/tree" + std::to_string(i) + ".json");
+
+        paths.push_back("tests/data/unique/1/a.txt");
+        paths.push_back("tests/data/trees/missing.json");
+
+        std::vector<std::promise<std::string>> results(paths.size());
+        std::vector<rex::ReadEngine::Request> requests;
+
+        for(size_t i = 0; i < paths.size(); ++i)
+        {
+            std::promise<std::string>* result = &results[i];
+
+            requests.push_back(rex::ReadEngine::Request{paths[i], [result] (rex::FileRead& read)
+            {
+                if(read.error)
+                    result->set_exception(read.error);
+                else
+                    result->set_value(std::string(read.data.get(), read.size));
+            }});
+        }
+
+        engine.submit(std::move(requests));
+
+        for(size_t i = 0; i + 2 < paths.size(); ++i)
+            CHECK(results[i].get_future().get() == fileContents(paths[i]));
+
+        CHECK(results[paths.size() - 2].get_future().get().empty());
+        CHECK_THROWS_AS(results[paths.size() - 1].get_future().get(), rex::InvalidFileException);
+    }
+
+#ifndef _WIN32
+    //reads far more files at once than the process may keep open
+    void checkManyReads(rex::ReadEngine& engine)
+    {
+        rlimit limit;
+        REQUIRE(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+        rlimit lowered = limit;
+        lowered.rlim_cur = std::min<rlim_t>(limit.rlim_cur, 256);
+        REQUIRE(setrlimit(RLIMIT_NOFILE, &lowered) == 0);
+
+        std::string expected = fileContents("tests/data/trees/tree0.json");
+        size_t count = 2000;
+        std::promise<void> done;
+        std::mutex mutex;
+        size_t finished = 0;
+        size_t correct = 0;
+        std::vector<rex::ReadEngine::Request> requests;
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            requests.push_back(rex::ReadEngine::Request{"tests/data/trees/tree0.json", [&] (rex::FileRead& read)
+            {
+                bool last = false;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    if(!read.error && std::string(read.data.get(), read.size) == expected)
+                        ++correct;
+
+                    last = ++finished == count;
+                }
+
+                //only after the lock is given back, since the mutex goes away once the waiting thread wakes up
+                if(last)
+                    done.set_value();
+            }});
+        }
+
+        engine.submit(std::move(requests));
+        done.get_future().wait();
+        setrlimit(RLIMIT_NOFILE, &limit);
+
+        CHECK(correct == count);
+    }
+#endif
+}
+
+SCENARIO("ReadEngine reads whole files in the background and hands them to the completions")
+{
+    GIVEN("a read engine that uses io_uring where it can, with a depth smaller than the amount of files that are read")
+    {
+        rex::ReadEngine engine(2, 4, rex::ReadEngine::Backend::IO_URING);
+
+        WHEN("many files are read at once")
+        {
+            THEN("every file is read in full, and missing ones fail")
+            {
+                checkReads(engine);
+            }
+        }
+
+#ifndef _WIN32
+        WHEN("more files are read at once than the process may keep open")
+        {
+            THEN("the files are only opened as the reads get room in the ring, so every read succeeds")
+            {
+                checkManyReads(engine);
+            }
+        }
+#endif
+    }
+
+    GIVEN("a read engine that reads on threads")
+    {
+        rex::ReadEngine engine(2, 4, rex::ReadEngine::Backend::THREADS);
+
+        WHEN("many files are read at once")
+        {
+            THEN("every file is read in full, and missing ones fail, the same as with io_uring")
+            {
+                CHECK(engine.backend() == rex::ReadEngine::Backend::THREADS);
+                checkReads(engine);
+            }
+        }
+    }
+}
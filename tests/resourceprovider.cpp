@@ -1,11 +1,16 @@
 #include <catch.hpp>
+#include <fstream>
+#include <iterator>
 #include <map>
+#include <thread>
 #include "helpers/person.hpp"
 #include "helpers/tool.hpp"
 #include "helpers/peoplesource.hpp"
 #include "helpers/toolsource.hpp"
 #include <rex/resourceprovider.hpp>
 
+#include "helpers/tempfolder.hpp"
+#include "helpers/textfilesource.hpp"
 #include "helpers/treefilesource.hpp"
 
 SCENARIO("ResourceProvider can manage sources")
@@ -271,6 +276,143 @@ SCENARIO("ResourceProvider can be used to access resources synchronously from so
     }
 }
 
+SCENARIO("ResourceProvider can resolve resources into handles that are accessed without looking them up again")
+{
+    GIVEN("a resource provider with a source added")
+    {
+        rex::ResourceProvider provider;
+
+        provider.addSource("people", PeopleSource("tests/data/people", false));
+
+        WHEN("a handle is resolved for a resource that is not loaded yet")
+        {
+            rex::ResourceHandle<Person> handle = provider.handle<Person>("people", "anders");
+
+            THEN("the handle is valid and identifies the resource but it is not loaded")
+            {
+                CHECK(handle.valid());
+                CHECK(handle.sourceId() == "people");
+                CHECK(handle.identifier() == "anders");
+                CHECK_FALSE(handle.loaded());
+            }
+
+            THEN("getting the resource through the handle loads it and gives the same instance as getting it by name")
+            {
+                const Person& person = provider.get(handle);
+
+                CHECK(handle.loaded());
+                CHECK(person.name == "anders");
+                CHECK(person.age == 47);
+                CHECK(&person == &provider.get<Person>("people", "anders"));
+            }
+
+            THEN("the resource stays loaded while it is marked as unused until the last handle to it is gone, and can be loaded again after that")
+            {
+                provider.get(handle);
+                provider.markUnused("people", "anders");
+
+                CHECK(handle.loaded());
+                CHECK(provider.get(handle).name == "anders");
+
+                handle = rex::ResourceHandle<Person>();
+                rex::ResourceHandle<Person> newHandle = provider.handle<Person>("people", "anders");
+
+                CHECK_FALSE(newHandle.loaded());
+
+                const Person& person = provider.get(newHandle);
+                CHECK(person.name == "anders");
+                CHECK(newHandle.loaded());
+            }
+        }
+
+        WHEN("a handle is resolved for a resource that is already loaded")
+        {
+            const Person& person = provider.get<Person>("people", "kalle");
+            rex::ResourceHandle<Person> handle = provider.handle<Person>("people", "kalle");
+
+            THEN("the handle is loaded and gives the same instance")
+            {
+                CHECK(handle.loaded());
+                CHECK(&provider.get(handle) == &person);
+            }
+        }
+
+        WHEN("a handle is resolved for an invalid resource")
+        {
+            rex::ResourceHandle<Person> handle = provider.handle<Person>("people", "asdf");
+
+            THEN("getting the resource through the handle throws an exception")
+            {
+                CHECK_THROWS_AS(provider.get(handle), rex::InvalidResourceException);
+            }
+        }
+
+        WHEN("a handle is resolved with the wrong type or from an invalid source")
+        {
+            THEN("an exception is thrown")
+            {
+                CHECK_THROWS_AS(provider.handle<Tool>("people", "anders"), rex::InvalidSourceException);
+                CHECK_THROWS_AS(provider.handle<Tool>("tools", "hammer"), rex::InvalidSourceException);
+            }
+        }
+
+        WHEN("handles and views to resources of a source are kept while the source is removed")
+        {
+            rex::ResourceHandle<Person> handle = provider.handle<Person>("people", "anders");
+            provider.get(handle);
+            std::vector<rex::ResourceView<Person>> views = provider.getAll<Person>("people");
+
+            provider.markAllUnused("people");
+            provider.removeSource("people");
+
+            THEN("the resources stay valid until the last of them is let go of, without counting against the memory of the provider anymore")
+            {
+                CHECK(provider.memoryUsage() == 0);
+                CHECK(handle.identifier() == "anders");
+                CHECK(handle.loaded());
+
+                for(const auto& view : views)
+                    CHECK(view.resource.name == view.identifier);
+
+                views.clear();
+                handle = rex::ResourceHandle<Person>();
+
+                CHECK(provider.memoryUsage() == 0);
+            }
+        }
+
+        WHEN("a handle outlives the provider it was resolved from")
+        {
+            rex::ResourceHandle<Person> handle;
+
+            {
+                rex::ResourceProvider shortLived;
+                shortLived.addSource("people", PeopleSource("tests/data/people", false));
+                handle = shortLived.handle<Person>("people", "kalle");
+                shortLived.get(handle);
+            }
+
+            THEN("it still identifies its resource, which stays loaded until the handle goes away")
+            {
+                CHECK(handle.identifier() == "kalle");
+                CHECK(handle.loaded());
+            }
+        }
+
+        WHEN("an empty handle is used")
+        {
+            rex::ResourceHandle<Person> handle;
+
+            THEN("it is not valid and accessing it throws an exception")
+            {
+                CHECK_FALSE(handle.valid());
+                CHECK_FALSE(handle.loaded());
+                CHECK_THROWS_AS(provider.get(handle), rex::InvalidResourceException);
+            }
+        }
+    }
+}
+
 #ifndef REX_DISABLE_ASYNC
 SCENARIO("ResourceProvider can be used to access resources asynchronously from sources")
 {
@@ -336,6 +478,33 @@ SCENARIO("ResourceProvider can be used to access resources asynchronously from s
             }
         }
 
+        WHEN("a batch of resources is accessed asynchronously with repeated and already loaded ids")
+        {
+            provider.get<Person>("people", "kalle");
+            std::vector<rex::AsyncResourceView<Person>> persons = provider.asyncGet<Person>("people", std::vector<std::string>{"anders", "kalle", "torsten", "anders"});
+
+            THEN("the views come back in the requested order and already loaded ones are ready directly")
+            {
+                REQUIRE(persons.size() == 4);
+                CHECK(persons[0].identifier == "anders");
+                CHECK(persons[1].identifier == "kalle");
+                CHECK(persons[2].identifier == "torsten");
+                CHECK(persons[3].identifier == "anders");
+                CHECK(persons[1].future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready);
+            }
+
+            THEN("repeated ids resolve to the same instance")
+            {
+                REQUIRE(persons[0].future.wait_for(std::chrono::milliseconds(300)) == std::future_status::ready);
+                REQUIRE(persons[2].future.wait_for(std::chrono::milliseconds(300)) == std::future_status::ready);
+                REQUIRE(persons[3].future.wait_for(std::chrono::milliseconds(300)) == std::future_status::ready);
+
+                CHECK(&persons[0].future.get() == &persons[3].future.get());
+                CHECK(persons[0].future.get().age == 47);
+                CHECK(persons[2].future.get().age == 94);
+            }
+        }
+
         WHEN("invalid resources are accessed asynchronously")
         {
             rex::AsyncResourceView<Person> personView = provider.asyncGet<Person>("people", "asdf");
@@ -518,6 +687,52 @@ SCENARIO("ResourceProvider can be used to access all resources from a source in
         }
     }
 }
+
+SCENARIO("ResourceProvider can be used to access the same resources from many threads at once")
+{
+    GIVEN("a resource provider with a source added")
+    {
+        rex::ResourceProvider provider;
+
+        provider.addSource("trees", TreeFileSource("tests/data/trees"));
+
+        WHEN("many threads get the same resources synchronously at the same time")
+        {
+            const int32_t threadCount = 8;
+            const int32_t treeCount = 50;
+
+            std::vector<std::vector<const Tree*>> gotten(threadCount, std::vector<const Tree*>(treeCount, nullptr));
+            std::vector<std::thread> threads;
+
+            for(int32_t t = 0; t < threadCount; ++t)
+            {
+                threads.emplace_back([&provider, &gotten, t, treeCount] ()
+                {
+                    for(int32_t i = 0; i < treeCount; ++i)
+                    {
+                        int32_t treeIndex = (i + t * 7) % treeCount;
+                        gotten[t][treeIndex] = &provider.get<Tree>("trees", "tree" + std::to_string(treeIndex));
+                    }
+                });
+            }
+
+            for(auto& thread : threads)
+                thread.join();
+
+            THEN("every thread is given the same, once loaded, instance of each resource")
+            {
+                for(int32_t t = 1; t < threadCount; ++t)
+                {
+                    for(int32_t i = 0; i < treeCount; ++i)
+                        CHECK(gotten[t][i] == gotten[0][i]);
+                }
+
+                CHECK(gotten[0][1]->leafType == "gigantic");
+                CHECK(gotten[0][2]->leafType == "wide");
+            }
+        }
+    }
+}
 #endif
 
 SCENARIO("Resources in valid sources can be marked as unused")
@@ -540,6 +755,36 @@ SCENARIO("Resources in valid sources can be marked as unused")
             }
         }
 
+        WHEN("resources are marked as unused while there are views of them")
+        {
+            std::vector<rex::ResourceView<Person>> people = provider.get<Person>("people", std::vector<std::string>{"kalle", "anders"});
+#ifndef REX_DISABLE_ASYNC
+            rex::AsyncResourceView<Person> asyncPerson = provider.asyncGet<Person>("people", "kalle");
+#endif
+            size_t usage = provider.memoryUsage("people");
+
+            provider.markUnused("people", "kalle");
+            provider.markAllUnused("people");
+
+            THEN("the views stay valid and the memory is only reclaimed once the last view is gone")
+            {
+                CHECK(provider.memoryUsage("people") == usage);
+                CHECK(people[0].resource.name == "kalle");
+                CHECK(people[1].resource.name == "anders");
+#ifndef REX_DISABLE_ASYNC
+                CHECK(asyncPerson.future.get().name == "kalle");
+#endif
+
+                people.clear();
+#ifndef REX_DISABLE_ASYNC
+                CHECK(provider.memoryUsage("people") == usage / 2);
+
+                asyncPerson = rex::AsyncResourceView<Person>();
+#endif
+                CHECK(provider.memoryUsage("people") == 0);
+            }
+        }
+
         WHEN("resources are marked as unused in an invalid source")
         {
             THEN("an exception is thrown")
@@ -577,3 +822,985 @@ SCENARIO("All resources in a source can be marked as invalid")
         }
     }
 }
+
+SCENARIO("ResourceProvider can keep the memory used by loaded resources within a budget")
+{
+    GIVEN("a resource provider with a source added")
+    {
+        rex::ResourceProvider provider;
+
+        provider.addSource("people", PeopleSource("tests/data/people", false));
+
+        WHEN("resources are loaded without a budget")
+        {
+            provider.getAll<Person>("people");
+
+            THEN("all of them are kept and the usage is tracked per source and in total")
+            {
+                CHECK(provider.memoryUsage("people") == 3 * sizeof(Person));
+                CHECK(provider.memoryUsage() == 3 * sizeof(Person));
+            }
+
+            THEN("marking them unused gives the memory back")
+            {
+                provider.markUnused("people", "kalle");
+                CHECK(provider.memoryUsage("people") == 2 * sizeof(Person));
+
+                provider.markAllUnused("people");
+                CHECK(provider.memoryUsage("people") == 0);
+                CHECK(provider.memoryUsage() == 0);
+            }
+        }
+
+        WHEN("the source is given a budget that fits two resources and three are loaded")
+        {
+            provider.setMemoryBudget("people", 2 * sizeof(Person));
+
+            provider.get<Person>("people", "anders");
+            provider.get<Person>("people", "kalle");
+            rex::ResourceHandle<Person> torsten = provider.handle<Person>("people", "torsten");
+            provider.get(torsten);
+
+            THEN("a resource is evicted to stay within the budget, but never the one just loaded")
+            {
+                CHECK(provider.memoryUsage("people") <= 2 * sizeof(Person));
+                CHECK(torsten.loaded());
+                CHECK(provider.get(torsten).name == "torsten");
+            }
+
+            THEN("evicted resources are transparently loaded again when accessed")
+            {
+                CHECK(provider.get<Person>("people", "anders").age == 47);
+                CHECK(provider.get<Person>("people", "kalle").age == 19);
+                CHECK(provider.memoryUsage("people") <= 2 * sizeof(Person));
+            }
+        }
+
+        WHEN("a total budget is set and there is a handle to a resource")
+        {
+            provider.setMemoryBudget(sizeof(Person));
+
+            rex::ResourceHandle<Person> handle = provider.handle<Person>("people", "anders");
+            provider.get(handle);
+            provider.get<Person>("people", "kalle");
+            provider.get<Person>("people", "torsten");
+
+            THEN("the resource with a handle to it is never evicted")
+            {
+                CHECK(handle.loaded());
+                CHECK(provider.get(handle).age == 47);
+            }
+        }
+
+        WHEN("a budget is lowered after resources are loaded")
+        {
+            provider.getAll<Person>("people");
+            provider.setMemoryBudget(sizeof(Person));
+
+            THEN("resources are evicted right away")
+            {
+                CHECK(provider.memoryUsage() <= sizeof(Person));
+            }
+        }
+    }
+}
+
+struct Counted
+{
+    Counted(const std::string& id):
+        id(id)
+    {
+        ++alive;
+    }
+
+    Counted(Counted&& other):
+        id(std::move(other.id))
+    {
+        ++alive;
+    }
+
+    ~Counted()
+    {
+        --alive;
+    }
+
+    std::string id;
+    static int32_t alive;
+};
+
+int32_t Counted::alive = 0;
+
+class CountedSource
+{
+    public:
+        Counted load(const std::string& id) const
+        {
+            return Counted(id);
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"a", "b", "c"};
+        }
+};
+
+SCENARIO("ResourceProvider keeps loaded resources by value and destroys each of them exactly once")
+{
+    GIVEN("a resource provider with a source of resources that count their instances")
+    {
+        std::unique_ptr<rex::ResourceProvider> provider(new rex::ResourceProvider());
+        provider->addSource("counted", CountedSource());
+
+        WHEN("resources are loaded, unloaded and loaded again")
+        {
+            provider->getAll<Counted>("counted");
+            CHECK(Counted::alive == 3);
+
+            provider->markUnused("counted", "b");
+            CHECK(Counted::alive == 2);
+
+            const Counted& reloaded = provider->get<Counted>("counted", "b");
+            CHECK(reloaded.id == "b");
+            CHECK(Counted::alive == 3);
+
+            THEN("the ones still loaded are destroyed with the provider")
+            {
+                provider.reset();
+                CHECK(Counted::alive == 0);
+            }
+        }
+    }
+}
+
+class ArenaCountedSource : public CountedSource
+{
+    public:
+        static constexpr size_t arenaChunk = 2;
+};
+
+SCENARIO("ResourceProvider can keep the resources of a source in an arena that is released as a whole")
+{
+    GIVEN("a resource provider with a source that opts in to an arena and has its resources loaded")
+    {
+        rex::ResourceProvider provider;
+        provider.addSource("counted", ArenaCountedSource());
+        provider.getAll<Counted>("counted");
+        CHECK(Counted::alive == 3);
+
+        WHEN("all resources are marked as unused")
+        {
+            provider.markAllUnused("counted");
+
+            THEN("all of them are destroyed and can be loaded again")
+            {
+                CHECK(Counted::alive == 0);
+                CHECK(provider.memoryUsage("counted") == 0);
+                CHECK(provider.get<Counted>("counted", "c").id == "c");
+                CHECK(Counted::alive == 1);
+            }
+        }
+
+        WHEN("all resources are marked as unused while there is a view of one of them")
+        {
+            std::vector<rex::ResourceView<Counted>> views = provider.get<Counted>("counted", std::vector<std::string>{"a"});
+            provider.markAllUnused("counted");
+
+            THEN("the others are unloaded one by one and the viewed one is released with its view")
+            {
+                CHECK(Counted::alive == 1);
+                CHECK(views[0].resource.id == "a");
+
+                views.clear();
+                CHECK(Counted::alive == 0);
+            }
+        }
+    }
+}
+
+struct Material
+{
+    std::string id;
+    //how many of the counted resources were already loaded when this one was
+    size_t countedLoaded;
+};
+
+class MaterialSource
+{
+    public:
+        MaterialSource(const rex::ResourceProvider& provider):
+            mProvider(&provider)
+        {
+        }
+
+        Material load(const std::string& id) const
+        {
+            size_t countedLoaded = mProvider->memoryUsage("counted") / sizeof(Counted);
+
+            for(const auto& dependency : dependencies(id))
+            {
+                if(dependency.sourceId == "counted")
+                    mProvider->get<Counted>(dependency.sourceId, dependency.resourceId);
+                else
+                    mProvider->get<Material>(dependency.sourceId, dependency.resourceId);
+            }
+
+            return Material{id, countedLoaded};
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"plain", "ab", "abc"};
+        }
+
+        std::vector<rex::Dependency> dependencies(const std::string& id) const
+        {
+            if(id == "ab")
+                return {{"counted", "a"}, {"counted", "b"}};
+            else if(id == "abc")
+                return {{"materials", "ab"}, {"counted", "c"}};
+            else if(id == "loop")
+                return {{"materials", "loop_back"}};
+            else if(id == "loop_back")
+                return {{"materials", "loop"}};
+            else if(id == "broken")
+                return {{"counted", "a"}, {"nowhere", "x"}};
+
+            return {};
+        }
+    private:
+        const rex::ResourceProvider* mProvider;
+};
+
+SCENARIO("ResourceProvider loads the dependencies that a source declares before the resources that need them")
+{
+    GIVEN("a resource provider with a source of resources that depend on resources of another source")
+    {
+        rex::ResourceProvider provider;
+        provider.addSource("counted", CountedSource());
+        provider.addSource("materials", MaterialSource(provider));
+
+        WHEN("a resource with nested dependencies is gotten")
+        {
+            const Material& material = provider.get<Material>("materials", "abc");
+
+            THEN("all of its dependencies were loaded before it")
+            {
+                CHECK(material.countedLoaded == 3);
+                CHECK(provider.get<Material>("materials", "ab").countedLoaded == 2);
+                CHECK(Counted::alive == 3);
+            }
+        }
+
+        WHEN("a resource without dependencies is gotten")
+        {
+            THEN("nothing else is loaded")
+            {
+                CHECK(provider.get<Material>("materials", "plain").countedLoaded == 0);
+                CHECK(Counted::alive == 0);
+            }
+        }
+
+        WHEN("resources depend on each other in a loop or on a source that doesn't exist")
+        {
+            THEN("an exception is thrown")
+            {
+                CHECK_THROWS_AS(provider.get<Material>("materials", "loop"), rex::InvalidResourceException);
+                CHECK_THROWS_AS(provider.get<Material>("materials", "broken"), rex::InvalidSourceException);
+            }
+        }
+
+#ifndef REX_DISABLE_ASYNC
+        WHEN("resources with dependencies are accessed asynchronously")
+        {
+            rex::AsyncResourceView<Material> abc = provider.asyncGet<Material>("materials", "abc");
+            std::vector<rex::AsyncResourceView<Material>> batch = provider.asyncGet<Material>("materials", std::vector<std::string>{"ab", "plain"});
+
+            THEN("the dependencies are loaded in parallel before the resources that need them")
+            {
+                CHECK(abc.future.get().countedLoaded == 3);
+                CHECK(batch[0].future.get().countedLoaded >= 2);
+                CHECK(batch[1].future.get().id == "plain");
+            }
+        }
+
+        WHEN("a resource with dependencies in a loop is accessed asynchronously")
+        {
+            THEN("an exception is thrown")
+            {
+                CHECK_THROWS_AS(provider.asyncGet<Material>("materials", "loop"), rex::InvalidResourceException);
+            }
+        }
+#endif
+    }
+}
+
+#ifndef REX_DISABLE_ASYNC
+class ProgressiveSource
+{
+    public:
+        ProgressiveSource(std::shared_future<void> finish):
+            mFinish(finish)
+        {
+        }
+
+        std::string load(const std::string& id) const
+        {
+            return id + " in full detail";
+        }
+
+        std::string loadProgressively(const std::string& id, const std::function<void(std::string)>& publish) const
+        {
+            publish(id + " in low detail");
+            mFinish.wait();
+
+            if(id == "broken")
+                throw rex::InvalidResourceException("the rest of it is missing");
+
+            return load(id);
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"song", "broken"};
+        }
+    private:
+        std::shared_future<void> mFinish;
+};
+
+SCENARIO("ResourceProvider shows lower detail versions of resources that are loaded progressively")
+{
+    GIVEN("a resource provider with a source that publishes a lower detail version before finishing")
+    {
+        rex::ResourceProvider provider;
+        std::promise<void> finish;
+        provider.addSource("songs", ProgressiveSource(finish.get_future().share()));
+
+        WHEN("a resource is accessed asynchronously")
+        {
+            rex::AsyncResourceView<std::string> song = provider.asyncGet<std::string>("songs", "song");
+            rex::AsyncResourceView<std::string> broken = provider.asyncGet<std::string>("songs", "broken");
+
+            std::shared_ptr<const std::string> partial;
+
+            while(!(partial = provider.partial<std::string>("songs", "song")))
+                std::this_thread::yield();
+
+            THEN("the lower detail version can be used until the load is done, after which it is gone")
+            {
+                CHECK(*partial == "song in low detail");
+                CHECK(song.future.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+
+                finish.set_value();
+
+                CHECK(song.future.get() == "song in full detail");
+                CHECK_THROWS_AS(broken.future.get(), rex::InvalidResourceException);
+                CHECK(provider.partial<std::string>("songs", "song") == nullptr);
+                CHECK(provider.partial<std::string>("songs", "broken") == nullptr);
+                CHECK(*partial == "song in low detail");
+            }
+        }
+
+        WHEN("a resource that is not loading is looked at")
+        {
+            THEN("there is no lower detail version, and the type is checked")
+            {
+                CHECK(provider.partial<std::string>("songs", "song") == nullptr);
+                CHECK_THROWS_AS(provider.partial<int32_t>("songs", "song"), rex::InvalidSourceException);
+                finish.set_value();
+            }
+        }
+    }
+}
+#endif
+
+#ifndef REX_DISABLE_ASYNC
+class OrderedSource
+{
+    public:
+        OrderedSource(std::shared_future<void> open):
+            mOpen(open),
+            mOrder(std::make_shared<Order>())
+        {
+        }
+
+        std::string load(const std::string& id) const
+        {
+            {
+                std::lock_guard<std::mutex> lock(mOrder->mutex);
+                mOrder->ids.push_back(id);
+            }
+
+            if(id == "gate")
+                mOpen.wait();
+
+            return id;
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"gate", "a", "b", "c", "urgent"};
+        }
+
+        std::vector<std::string> order() const
+        {
+            std::lock_guard<std::mutex> lock(mOrder->mutex);
+            return mOrder->ids;
+        }
+    private:
+        struct Order
+        {
+            std::mutex mutex;
+            std::vector<std::string> ids;
+        };
+
+        std::shared_future<void> mOpen;
+        std::shared_ptr<Order> mOrder;
+};
+
+SCENARIO("ResourceProvider starts asynchronous loads by priority, and queued loads can be given another priority")
+{
+    GIVEN("a resource provider with a single worker that is kept busy")
+    {
+        rex::ResourceProvider provider(1);
+        std::promise<void> open;
+        OrderedSource source(open.get_future().share());
+        provider.addSource("things", source);
+
+        rex::AsyncResourceView<std::string> gate = provider.asyncGet<std::string>("things", "gate");
+
+        while(source.order().empty())
+            std::this_thread::yield();
+
+        WHEN("loads are queued with different priorities and one of them is given a more urgent one")
+        {
+            std::vector<rex::AsyncResourceView<std::string>> normal = provider.asyncGet<std::string>("things", {"a", "b", "c"});
+            rex::AsyncResourceView<std::string> urgent = provider.asyncGet<std::string>("things", "urgent", -1);
+
+            bool prioritized = provider.prioritize("things", "c", -2);
+            bool prioritizedRunning = provider.prioritize("things", "gate", -2);
+            bool prioritizedUnknown = provider.prioritize("things", "d", -2);
+
+            open.set_value();
+
+            for(auto& view : normal)
+                view.future.wait();
+            urgent.future.wait();
+
+            THEN("they are loaded once each, in priority order")
+            {
+                CHECK(prioritized);
+                CHECK_FALSE(prioritizedRunning);
+                CHECK_FALSE(prioritizedUnknown);
+                std::vector<std::string> order = source.order();
+                REQUIRE(order.size() == 5);
+                CHECK(std::vector<std::string>(order.begin(), order.begin() + 3) == std::vector<std::string>({"gate", "c", "urgent"}));
+                CHECK(normal[2].future.get() == "c");
+                CHECK(gate.future.get() == "gate");
+                CHECK_FALSE(provider.prioritize("things", "c", -3));
+            }
+        }
+    }
+}
+#endif
+
+#ifndef REX_DISABLE_ASYNC
+class SlowSource
+{
+    public:
+        SlowSource(std::shared_future<void> open):
+            mOpen(open),
+            mLoads(std::make_shared<std::atomic<int32_t>>(0))
+        {
+        }
+
+        std::string load(const std::string& id) const
+        {
+            if(id == "slow")
+            {
+                ++*mLoads;
+                mOpen.wait();
+            }
+
+            return id + " loaded";
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"slow"};
+        }
+
+        int32_t slowLoads() const
+        {
+            return *mLoads;
+        }
+    private:
+        std::shared_future<void> mOpen;
+        std::shared_ptr<std::atomic<int32_t>> mLoads;
+};
+
+SCENARIO("ResourceProvider doesn't hold up other resources while a synchronous load runs")
+{
+    GIVEN("a resource provider with a source where one resource takes long to load")
+    {
+        rex::ResourceProvider provider;
+        std::promise<void> open;
+        SlowSource source(open.get_future().share());
+        provider.addSource("things", source);
+
+        WHEN("the slow resource is accessed synchronously from two threads")
+        {
+            std::string first;
+            std::string second;
+
+            std::thread firstThread([&] ()
+            {
+                first = provider.get<std::string>("things", "slow");
+            });
+
+            while(source.slowLoads() == 0)
+                std::this_thread::yield();
+
+            std::thread secondThread([&] ()
+            {
+                second = provider.get<std::string>("things", "slow");
+            });
+
+            THEN("other resources, including ones that share its lock, can be accessed while it loads, and it is only loaded once")
+            {
+                //more resources than there are shards, so some of them share the shard of the slow one
+                for(int32_t i = 0; i < 64; ++i)
+                    CHECK(provider.get<std::string>("things", std::to_string(i)) == std::to_string(i) + " loaded");
+
+                open.set_value();
+                firstThread.join();
+                secondThread.join();
+
+                CHECK(first == "slow loaded");
+                CHECK(second == "slow loaded");
+                CHECK(source.slowLoads() == 1);
+            }
+        }
+    }
+}
+#endif
+
+#ifndef REX_DISABLE_ASYNC
+//'a' needs 'b' and 'c' needs 'a', and the blockers hold up workers until they are let go
+class ChainSource
+{
+    public:
+        ChainSource(const rex::ResourceProvider& provider, std::shared_future<void> queued, std::shared_future<void> released):
+            mProvider(&provider),
+            mQueued(queued),
+            mReleased(released),
+            mBlocked(std::make_shared<std::atomic<int32_t>>(0)),
+            mStarted(std::make_shared<std::atomic<bool>>(false))
+        {
+        }
+
+        std::string load(const std::string& id) const
+        {
+            if(id == "blocker1" || id == "blocker2")
+            {
+                ++*mBlocked;
+                mReleased.wait();
+            }
+            else if(id == "a")
+            {
+                *mStarted = true;
+                mQueued.wait();
+                return "a" + mProvider->get<std::string>("chain", "b");
+            }
+            else if(id == "c")
+            {
+                return "c" + mProvider->get<std::string>("chain", "a");
+            }
+
+            return id;
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"blocker1", "blocker2", "a", "b", "c"};
+        }
+
+        int32_t blocked() const
+        {
+            return *mBlocked;
+        }
+
+        bool started() const
+        {
+            return *mStarted;
+        }
+    private:
+        const rex::ResourceProvider* mProvider;
+        std::shared_future<void> mQueued;
+        std::shared_future<void> mReleased;
+        std::shared_ptr<std::atomic<int32_t>> mBlocked;
+        std::shared_ptr<std::atomic<bool>> mStarted;
+};
+
+SCENARIO("ResourceProvider doesn't let a waiting loader pick up work that waits on it in turn")
+{
+    GIVEN("a resource provider with three workers, two of which are held up")
+    {
+        rex::ResourceProvider provider(3);
+        std::promise<void> queued;
+        std::promise<void> released;
+        ChainSource source(provider, queued.get_future().share(), released.get_future().share());
+        provider.addSource("chain", source);
+
+        std::vector<rex::AsyncResourceView<std::string>> blockers = provider.asyncGet<std::string>("chain", std::vector<std::string>{"blocker1", "blocker2"});
+
+        while(source.blocked() < 2)
+            std::this_thread::yield();
+
+        WHEN("the loader of a resource gets one that is queued, while an urgent load that needs the first one is queued too")
+        {
+            rex::AsyncResourceView<std::string> a = provider.asyncGet<std::string>("chain", "a");
+
+            while(!source.started())
+                std::this_thread::yield();
+
+            rex::AsyncResourceView<std::string> b = provider.asyncGet<std::string>("chain", "b");
+            rex::AsyncResourceView<std::string> c = provider.asyncGet<std::string>("chain", "c", -1);
+
+            queued.set_value();
+            released.set_value();
+
+            THEN("everything finishes")
+            {
+                REQUIRE(c.future.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+                CHECK(c.future.get() == "cab");
+                CHECK(a.future.get() == "ab");
+                CHECK(b.future.get() == "b");
+            }
+        }
+    }
+}
+#endif
+
+#ifndef REX_DISABLE_ASYNC
+class GraphSource
+{
+    public:
+        GraphSource(const rex::ResourceProvider& provider, std::shared_future<void> released):
+            mProvider(&provider),
+            mReleased(std::move(released)),
+            mBlocked(std::make_shared<std::atomic<bool>>(false))
+        {
+        }
+
+        std::string load(const std::string& id) const
+        {
+            if(id == "blocker")
+            {
+                *mBlocked = true;
+                mReleased.wait();
+            }
+            else if(id == "x")
+            {
+                return "x" + mProvider->get<std::string>("graph", "m");
+            }
+
+            return id;
+        }
+
+        std::vector<std::string> list() const
+        {
+            return {"blocker", "m", "t", "x"};
+        }
+
+        std::vector<rex::Dependency> dependencies(const std::string& id) const
+        {
+            if(id == "m")
+                return {{"graph", "t"}};
+
+            return {};
+        }
+
+        bool blocked() const
+        {
+            return *mBlocked;
+        }
+    private:
+        const rex::ResourceProvider* mProvider;
+        std::shared_future<void> mReleased;
+        std::shared_ptr<std::atomic<bool>> mBlocked;
+};
+
+SCENARIO("ResourceProvider lets a loader that waits for a resource with dependencies load them itself")
+{
+    GIVEN("a resource provider with a single worker that is held up")
+    {
+        rex::ResourceProvider provider(1);
+        std::promise<void> released;
+        GraphSource source(provider, released.get_future().share());
+        provider.addSource("graph", source);
+
+        rex::AsyncResourceView<std::string> blocker = provider.asyncGet<std::string>("graph", "blocker");
+
+        while(!source.blocked())
+            std::this_thread::yield();
+
+        WHEN("a resource waits for its dependency in the pool, and an urgent load gets it from the only worker")
+        {
+            rex::AsyncResourceView<std::string> m = provider.asyncGet<std::string>("graph", "m");
+            rex::AsyncResourceView<std::string> x = provider.asyncGet<std::string>("graph", "x", -1);
+
+            released.set_value();
+
+            THEN("everything finishes")
+            {
+                REQUIRE(x.future.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+                CHECK(x.future.get() == "xm");
+                CHECK(m.future.get() == "m");
+                CHECK(provider.get<std::string>("graph", "t") == "t");
+            }
+        }
+    }
+}
+
+SCENARIO("ResourceProvider finishes the loads of a source that are still queued before removing it")
+{
+    GIVEN("a resource provider with a single worker that is held up")
+    {
+        rex::ResourceProvider provider(1);
+        std::promise<void> released;
+        GraphSource source(provider, released.get_future().share());
+        provider.addSource("graph", source);
+        provider.addSource("people", PeopleSource("tests/data/people", false));
+
+        rex::AsyncResourceView<std::string> blocker = provider.asyncGet<std::string>("graph", "blocker");
+
+        while(!source.blocked())
+            std::this_thread::yield();
+
+        WHEN("a source is removed while a load of it waits in the pool")
+        {
+            rex::AsyncResourceView<Person> anders = provider.asyncGet<Person>("people", "anders");
+
+            provider.removeSource("people");
+
+            THEN("the load is done by the time the source is gone, and the pool has nothing left that refers to it")
+            {
+                REQUIRE(anders.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+                CHECK(anders.future.get().age == 47);
+
+                released.set_value();
+                CHECK(blocker.future.get() == "blocker");
+            }
+        }
+
+        WHEN("all sources are cleared while a load waits in the pool")
+        {
+            rex::AsyncResourceView<Person> kalle = provider.asyncGet<Person>("people", "kalle");
+
+            released.set_value();
+            provider.clearSources();
+
+            THEN("the load is done by the time the sources are gone")
+            {
+                REQUIRE(kalle.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+                CHECK(kalle.future.get().age == 19);
+            }
+        }
+    }
+}
+
+SCENARIO("ResourceProvider reads the files of sources that are loaded in stages in the background and decodes them on its workers")
+{
+    GIVEN("a resource provider with a mapped file source")
+    {
+        rex::ResourceProvider provider;
+        provider.addSource("texts", TextFileSource("tests/data/trees"));
+
+        WHEN("all resources and one that doesn't exist are accessed asynchronously")
+        {
+            std::vector<rex::AsyncResourceView<std::string>> texts = provider.asyncGetAll<std::string>("texts");
+            rex::AsyncResourceView<std::string> missing = provider.asyncGet<std::string>("texts", std::vector<std::string>{"tree1", "nothing"})[1];
+
+            THEN("they hold the same as when loaded synchronously, and the one that doesn't exist fails")
+            {
+                CHECK((rex::HasFileStages<TextFileSource, std::string>::value));
+                REQUIRE(texts.size() == provider.list("texts").size());
+
+                for(auto& text : texts)
+                {
+                    std::ifstream file("tests/data/trees/" + text.identifier + ".json", std::ios::binary);
+                    std::string expected((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+                    CHECK(text.future.get() == expected);
+                }
+
+                CHECK_THROWS_AS(missing.future.get(), rex::InvalidResourceException);
+            }
+        }
+    }
+
+    GIVEN("a resource provider with a single reader that keeps at most two reads in flight, and a mapped file source")
+    {
+        rex::ResourceProvider provider(2, 1, 2);
+        provider.addSource("texts", TextFileSource("tests/data/trees"));
+
+        WHEN("resources are accessed asynchronously one by one, more than there is room for in the read stage")
+        {
+            std::vector<rex::AsyncResourceView<std::string>> texts;
+
+            for(int32_t i = 0; i < 30; ++i)
+                texts.push_back(provider.asyncGet<std::string>("texts", "tree" + std::to_string(i)));
+
+            rex::AsyncResourceView<std::string> missing = provider.asyncGet<std::string>("texts", "nothing");
+
+            THEN("they are all read and decoded, and the one that doesn't exist fails")
+            {
+                for(auto& text : texts)
+                    CHECK(text.future.get() == provider.source<TextFileSource>("texts").source.load(text.identifier));
+
+                CHECK_THROWS_AS(missing.future.get(), rex::InvalidResourceException);
+            }
+        }
+    }
+}
+
+SCENARIO("ResourceProvider swaps in new versions of resources whose files change, without holding up readers")
+{
+    GIVEN("a resource provider with a file source of a file that is about to change")
+    {
+        TempFolder folder;
+        REQUIRE_FALSE(folder.path().empty());
+
+        std::string notePath = folder.file("note.txt");
+        std::ofstream(notePath, std::ios::binary | std::ios::trunc) << "first";
+
+        rex::ResourceProvider provider;
+        provider.addSource("texts", TextFileSource(folder.path()));
+
+        WHEN("a loaded resource is reloaded after its file changed, while a handle holds on to it")
+        {
+            rex::ResourceHandle<std::string> handle = provider.handle<std::string>("texts", "note");
+            const std::string& old = provider.get(handle);
+
+            std::ofstream(notePath, std::ios::binary | std::ios::trunc) << "second";
+            provider.reload("texts", "note").get();
+
+            THEN("readers get the new version, and the old one stays valid and counts against the budget until the handle is gone")
+            {
+                CHECK(provider.get<std::string>("texts", "note") == "second");
+                CHECK(provider.get(handle) == "second");
+                CHECK(old == "first");
+                CHECK(provider.memoryUsage("texts") == 2 * sizeof(std::string));
+                CHECK(provider.memoryUsage() == 2 * sizeof(std::string));
+
+                handle = rex::ResourceHandle<std::string>();
+                CHECK(provider.get<std::string>("texts", "note") == "second");
+                CHECK(provider.memoryUsage("texts") == sizeof(std::string));
+                CHECK(provider.memoryUsage() == sizeof(std::string));
+            }
+        }
+
+        WHEN("a loaded resource that nothing pins is reloaded after its file changed, again and again")
+        {
+            provider.get<std::string>("texts", "note");
+
+            for(int32_t i = 0; i < 10; ++i)
+            {
+                std::ofstream(notePath, std::ios::binary | std::ios::trunc) << "version" << i;
+                provider.reload("texts", "note").get();
+            }
+
+            THEN("the old versions are freed right away, so only the latest counts against the budget")
+            {
+                CHECK(provider.get<std::string>("texts", "note") == "version9");
+                CHECK(provider.memoryUsage("texts") == sizeof(std::string));
+                CHECK(provider.memoryUsage() == sizeof(std::string));
+            }
+        }
+
+        WHEN("the source is removed right after a reload is queued")
+        {
+            provider.get<std::string>("texts", "note");
+            std::future<void> reloaded = provider.reload("texts", "note");
+
+            provider.removeSource("texts");
+
+            THEN("the reload is done by the time the source is gone")
+            {
+                //the reload is counted as done just before its future is set, so the future may still take a moment
+                CHECK_NOTHROW(reloaded.get());
+            }
+        }
+
+        WHEN("a resource that is not loaded is reloaded")
+        {
+            provider.reload("texts", "note").get();
+
+            THEN("it is left alone")
+            {
+                CHECK_FALSE(provider.handle<std::string>("texts", "note").loaded());
+            }
+        }
+
+        WHEN("the file of a loaded resource can no longer be loaded when it is reloaded")
+        {
+            provider.get<std::string>("texts", "note");
+            std::remove(notePath.c_str());
+
+            std::future<void> reloaded = provider.reload("texts", "note");
+
+            THEN("the reload fails and the old version stays")
+            {
+                CHECK_THROWS_AS(reloaded.get(), rex::InvalidResourceException);
+                CHECK(provider.get<std::string>("texts", "note") == "first");
+            }
+        }
+
+        WHEN("the files of the source are watched and the file of a loaded resource is written")
+        {
+            provider.get<std::string>("texts", "note");
+            provider.watchFiles("texts");
+
+            std::ofstream(notePath, std::ios::binary | std::ios::trunc) << "third";
+
+            THEN("the new version is swapped in on its own")
+            {
+                for(int32_t i = 0; i < 500 && provider.get<std::string>("texts", "note") != "third"; ++i)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+                CHECK(provider.get<std::string>("texts", "note") == "third");
+            }
+        }
+
+        WHEN("a provider that watches the files of a source is moved, and the file of a loaded resource is written afterwards")
+        {
+            provider.get<std::string>("texts", "note");
+            provider.watchFiles("texts");
+
+            rex::ResourceProvider moved(std::move(provider));
+            rex::ResourceProvider assigned;
+            assigned = std::move(moved);
+
+            std::ofstream(notePath, std::ios::binary | std::ios::trunc) << "third";
+
+            THEN("the provider it ended up in swaps in the new version")
+            {
+                for(int32_t i = 0; i < 500 && assigned.get<std::string>("texts", "note") != "third"; ++i)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+                CHECK(assigned.get<std::string>("texts", "note") == "third");
+            }
+        }
+
+        WHEN("the files of a source that doesn't name them are to be watched")
+        {
+            provider.addSource("people", PeopleSource("tests/data/people", false));
+
+            THEN("it is an error")
+            {
+                CHECK_THROWS_AS(provider.watchFiles("people"), rex::InvalidSourceException);
+            }
+        }
+    }
+}
+#endif
@@ -1,4 +1,6 @@
 #include <catch.hpp>
+#include <array>
+#include <numeric>
 #include <rex/threadpool.hpp>
 
 SCENARIO("ThreadPool can be used to enqueue work which finishes asynchronously")
@@ -31,3 +33,249 @@ SCENARIO("ThreadPool can be used to enqueue work which finishes asynchronously")
         }
     }
 }
+
+SCENARIO("ThreadPool spreads many tasks over its workers and runs all of them")
+{
+    GIVEN("a threadPool with several workers")
+    {
+        rex::ThreadPool threadPool(4);
+
+        WHEN("many tasks are given")
+        {
+            std::atomic<int32_t> counter(0);
+            std::vector<std::future<void>> results;
+
+            for(int32_t i = 0; i < 1000; ++i)
+            {
+                results.emplace_back(threadPool.enqueue([&counter]
+                {
+                    ++counter;
+                }));
+            }
+
+            for(auto& result : results)
+                result.wait();
+
+            THEN("every task has been run exactly once")
+            {
+                CHECK(counter == 1000);
+            }
+        }
+
+        WHEN("tasks enqueue more tasks from within the workers")
+        {
+            std::atomic<int32_t> counter(0);
+            std::vector<std::future<std::future<void>>> results;
+
+            for(int32_t i = 0; i < 100; ++i)
+            {
+                results.emplace_back(threadPool.enqueue([&threadPool, &counter]
+                {
+                    ++counter;
+                    return threadPool.enqueue([&counter]
+                    {
+                        ++counter;
+                    });
+                }));
+            }
+
+            for(auto& result : results)
+                result.get().wait();
+
+            THEN("both the outer and the inner tasks have been run")
+            {
+                CHECK(counter == 200);
+            }
+        }
+    }
+}
+
+SCENARIO("ThreadPool runs queued tasks in priority order")
+{
+    GIVEN("a threadPool with a single worker that is busy")
+    {
+        rex::ThreadPool threadPool(1);
+
+        std::promise<void> start;
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future();
+        std::future<void> blocker = threadPool.enqueue([&start, released]
+        {
+            start.set_value();
+            released.wait();
+        });
+
+        //otherwise the worker could still pick up an urgent task before the blocker
+        start.get_future().wait();
+
+        WHEN("tasks with different priorities are queued up and the worker is freed")
+        {
+            std::vector<int32_t> order;
+            std::vector<std::future<void>> results;
+
+            for(int32_t priority : {5, 0, -5, 0, 3, -10})
+            {
+                results.emplace_back(threadPool.enqueue([&order, priority]
+                {
+                    order.push_back(priority);
+                }, priority));
+            }
+
+            release.set_value();
+
+            for(auto& result : results)
+                result.wait();
+
+            THEN("lower priority values are run first")
+            {
+                CHECK(order == std::vector<int32_t>({-10, -5, 0, 0, 3, 5}));
+            }
+        }
+    }
+}
+
+SCENARIO("ThreadPool runs queued tasks while its workers wait")
+{
+    GIVEN("a threadPool with a single worker")
+    {
+        rex::ThreadPool threadPool(1);
+
+        WHEN("a task waits through the pool for tasks that it queued itself, nested a few levels deep")
+        {
+            std::function<int32_t(int32_t)> nested = [&threadPool, &nested] (int32_t depth)
+            {
+                if(depth == 0)
+                    return 1;
+
+                std::future<int32_t> inner = threadPool.enqueue(nested, 0, depth - 1);
+                threadPool.wait(inner);
+                return inner.get() + 1;
+            };
+
+            std::future<int32_t> result = threadPool.enqueue(nested, 0, 5);
+
+            THEN("the worker runs the queued tasks instead of stalling, and everything finishes")
+            {
+                threadPool.wait(result);
+                CHECK(result.get() == 6);
+            }
+        }
+    }
+}
+
+SCENARIO("ThreadPool doesn't run unrelated tasks on a worker that waits")
+{
+    GIVEN("a threadPool with a single worker that waits on something from outside of the pool")
+    {
+        rex::ThreadPool threadPool(1);
+
+        std::mutex mutex;
+        std::vector<std::string> order;
+        std::promise<void> started;
+        std::promise<void> outside;
+        std::shared_future<void> outsideDone = outside.get_future().share();
+
+        std::future<void> waiting = threadPool.enqueue([&] ()
+        {
+            started.set_value();
+            threadPool.wait(outsideDone);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back("waiting");
+        });
+
+        started.get_future().wait();
+
+        WHEN("another task is queued while it waits")
+        {
+            std::future<void> other = threadPool.enqueue([&] ()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back("other");
+            });
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            outside.set_value();
+
+            waiting.wait();
+            other.wait();
+
+            THEN("the other task is only run once the waiting one is done, since it might have needed something further down")
+            {
+                CHECK(order == std::vector<std::string>({"waiting", "other"}));
+            }
+        }
+    }
+}
+
+SCENARIO("ThreadPool takes any kind of task and hands back its result through the future")
+{
+    GIVEN("a threadPool")
+    {
+        rex::ThreadPool threadPool(2);
+
+        WHEN("a task is given an argument that can only be moved")
+        {
+            std::future<int32_t> result = threadPool.enqueue([] (const std::unique_ptr<int32_t>& value)
+            {
+                return *value;
+            }, 0, std::unique_ptr<int32_t>(new int32_t(7)));
+
+            THEN("the task is run with it")
+            {
+                CHECK(result.get() == 7);
+            }
+        }
+
+        WHEN("a task captures more than fits in place")
+        {
+            std::array<int64_t, 64> values;
+
+            for(size_t i = 0; i < values.size(); ++i)
+                values[i] = static_cast<int64_t>(i);
+
+            std::future<int64_t> result = threadPool.enqueue([values]
+            {
+                return std::accumulate(values.begin(), values.end(), int64_t(0));
+            });
+
+            THEN("the task is run all the same")
+            {
+                CHECK(result.get() == 2016);
+            }
+        }
+
+        WHEN("a task throws")
+        {
+            std::future<void> result = threadPool.enqueue([]
+            {
+                throw std::runtime_error("failed");
+            });
+
+            THEN("the exception is thrown from the future")
+            {
+                CHECK_THROWS_AS(result.get(), std::runtime_error);
+            }
+        }
+    }
+}
+
+SCENARIO("TaskMemory keeps released blocks for the next task of the same size")
+{
+    GIVEN("a block that was handed out and released")
+    {
+        void* block = rex::TaskMemory::allocate(100);
+        rex::TaskMemory::release(block, 100);
+
+        WHEN("a block of a similar size is asked for")
+        {
+            void* next = rex::TaskMemory::allocate(120);
+
+            THEN("the released block is given out again")
+            {
+                CHECK(next == block);
+                rex::TaskMemory::release(next, 120);
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+#include <rex/archive.hpp>
+
+//packs a folder into an archive that ArchiveSource can serve, naming the assets like a FileSource would
+int main(int argc, char** argv)
+{
+    if(argc < 3 || argc > 5)
+    {
+        std::cerr << "usage: " << argv[0] << " <archive> <folder> [no_ext|file_name|path] [regex]\n";
+        return 1;
+    }
+
+    rex::Naming naming = rex::Naming::NO_EXT;
+
+    if(argc > 3)
+    {
+        std::string namingName = argv[3];
+
+        if(namingName == "no_ext")
+            naming = rex::Naming::NO_EXT;
+        else if(namingName == "file_name")
+            naming = rex::Naming::FILE_NAME;
+        else if(namingName == "path")
+            naming = rex::Naming::PATH;
+        else
+        {
+            std::cerr << "unknown naming '" << namingName << "'\n";
+            return 1;
+        }
+    }
+
+    try
+    {
+        rex::ArchiveWriter writer;
+        writer.addFolder(argv[2], rex::Filter(argc > 4 ? argv[4] : ".*"), naming);
+        writer.write(argv[1]);
+    }
+    catch(const std::exception& exception)
+    {
+        std::cerr << exception.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}